@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "Command.h"
+#include "LevelScan.h"
+#include "OrderFlowGenerator.h"
+#include "OrderbookConfig.h"
+#include "OrderbookCore.h"
+#include "Trade.h"
+
+// latency and throughput of the book's hot paths under reproducible synthetic flow
+// usage: orderbook_bench [seed] [commands per workload] [scalar|avx2|avx512, the LevelScan kernels, the best by default]
+// every workload runs once per backend (map, ladder, ladder with the direct order id index, and that with lazy
+// cancels, compacted between commands outside the timing as an idle front end would) against a fresh
+// core, the prefill is untimed, then each command is timed on its own with steady_clock, so the figures include the clock's own cost (tens of ns)
+// the core is driven directly: the Orderbook wrapper adds one uncontended lock per call on top of this
+namespace
+{
+	constexpr std::uint64_t DefaultSeed = 42;
+	constexpr std::size_t DefaultCommands = 200'000;
+	constexpr std::size_t PrefillOrders = 20'000;
+	constexpr std::size_t CompactPerCommand = 4; // tombstones a lazy book may release between two commands
+
+	// what a command did, the latency of each kind is reported separately
+	enum class Operation
+	{
+		Add,
+		CrossingAdd, // a resting type add that traded on arrival, sweeps land here
+		FillAndKill,
+		FillOrKill,
+		Cancel,
+		Modify,
+		Count,
+	};
+	constexpr std::array<const char *, static_cast<std::size_t>(Operation::Count)> OperationNames{"add", "crossing add", "fill and kill", "fill or kill", "cancel", "modify"};
+
+	Operation Classify(const Command &command, bool traded)
+	{
+		switch (command.type_)
+		{
+		case Command::Type::Cancel:
+			return Operation::Cancel;
+		case Command::Type::Modify:
+			return Operation::Modify;
+		case Command::Type::Add:
+			break;
+		}
+		switch (command.orderType_)
+		{
+		case OrderType::FillAndKill:
+			return Operation::FillAndKill;
+		case OrderType::FillOrKill:
+			return Operation::FillOrKill;
+		default:
+			return traded ? Operation::CrossingAdd : Operation::Add;
+		}
+	}
+
+	struct Workload
+	{
+		const char *name_;
+		bool prefill_; // run against a resting book rather than an empty one
+		Commands (*generate_)(OrderFlowGenerator &generator, std::size_t count);
+	};
+	const std::array<Workload, 6> Workloads{{
+		{"deep book adds", false, [](OrderFlowGenerator &generator, std::size_t count)
+		 { return generator.DeepBookAdds(count); }},
+		{"cancel heavy", true, [](OrderFlowGenerator &generator, std::size_t count)
+		 { return generator.CancelHeavy(count); }},
+		{"sweeps", true, [](OrderFlowGenerator &generator, std::size_t count)
+		 { return generator.Sweeps(count); }},
+		{"fok/fak mix", true, [](OrderFlowGenerator &generator, std::size_t count)
+		 { return generator.FillOrKillMix(count); }},
+		{"modify storm", true, [](OrderFlowGenerator &generator, std::size_t count)
+		 { return generator.ModifyStorm(count); }},
+		{"deep fok scans", true, [](OrderFlowGenerator &generator, std::size_t count)
+		 { return generator.DeepFillOrKills(count); }},
+	}};
+
+	std::int64_t Percentile(const std::vector<std::int64_t> &sorted, double fraction)
+	{
+		const auto index = static_cast<std::size_t>(fraction * static_cast<double>(sorted.size()));
+		return sorted[std::min(index, sorted.size() - 1)];
+	}
+
+	void RunWorkload(const Workload &workload, const char *backend, const OrderbookConfig &config, std::uint64_t seed, std::size_t count)
+	{
+		// the same seed for every workload and backend, so each backend sees exactly the same commands
+		OrderFlowGenerator generator{seed};
+		const Commands prefill = workload.prefill_ ? generator.Prefill(PrefillOrders) : Commands{};
+		const Commands commands = workload.generate_(generator, count);
+
+		OrderbookCore core{config};
+		Trades trades;
+		trades.reserve(1024);
+		for (const auto &command : prefill)
+		{
+			core.Apply(command, trades);
+		}
+		trades.clear();
+
+		std::array<std::vector<std::int64_t>, static_cast<std::size_t>(Operation::Count)> latencies;
+		for (auto &samples : latencies)
+		{
+			samples.reserve(commands.size());
+		}
+		std::size_t fills = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (const auto &command : commands)
+		{
+			const auto before = std::chrono::steady_clock::now();
+			core.Apply(command, trades);
+			const auto after = std::chrono::steady_clock::now();
+			latencies[static_cast<std::size_t>(Classify(command, !trades.empty()))].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count());
+			fills += trades.size();
+			trades.clear();
+			core.CompactLevels(CompactPerCommand); // untimed, nothing to do without lazy cancels
+		}
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		std::printf("%-15s %-7s %10.0f ops/s  %zu commands, %zu fills, %zu resting\n",
+					workload.name_, backend, static_cast<double>(commands.size()) / elapsed.count(), commands.size(), fills, core.Size());
+		for (std::size_t operation = 0; operation < latencies.size(); ++operation)
+		{
+			auto &samples = latencies[operation];
+			if (samples.empty())
+			{
+				continue;
+			}
+			std::sort(samples.begin(), samples.end());
+			std::printf("    %-14s %9zu ops  p50 %6lld ns  p99 %6lld ns  p99.9 %7lld ns\n",
+						OperationNames[operation], samples.size(),
+						static_cast<long long>(Percentile(samples, 0.50)),
+						static_cast<long long>(Percentile(samples, 0.99)),
+						static_cast<long long>(Percentile(samples, 0.999)));
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const std::uint64_t seed = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : DefaultSeed;
+	const std::size_t count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : DefaultCommands;
+	if (argc > 3)
+	{
+		const std::string name = argv[3];
+		for (const auto isa : {LevelScan::Isa::Scalar, LevelScan::Isa::Avx2, LevelScan::Isa::Avx512})
+		{
+			if (name == LevelScan::Name(isa) && !LevelScan::Select(isa))
+			{
+				std::fprintf(stderr, "this CPU does not support %s\n", argv[3]);
+				return 1;
+			}
+		}
+	}
+
+	OrderbookConfig map;
+	map.orderCapacity_ = PrefillOrders + count; // no workload grows the pool, the timing never includes a slab allocation
+	OrderbookConfig ladder = map;
+	// a band around the generator's prices, wide enough for every price it draws
+	const OrderFlowGenerator prices{seed};
+	ladder.ladder_ = LadderConfig{prices.Mid() - 2 * prices.Depth(), 1, static_cast<std::size_t>(4 * prices.Depth())};
+	OrderbookConfig direct = ladder;
+	direct.directOrderIdWindow_ = map.orderCapacity_; // the generator hands out dense ids from 1
+	OrderbookConfig lazy = direct;
+	lazy.lazyCancel_ = true;
+
+	std::printf("seed %llu, %zu commands per workload, %s level scans\n", static_cast<unsigned long long>(seed), count, LevelScan::Name(LevelScan::Selected()));
+	for (const auto &workload : Workloads)
+	{
+		RunWorkload(workload, "map", map, seed, count);
+		RunWorkload(workload, "ladder", ladder, seed, count);
+		RunWorkload(workload, "direct", direct, seed, count);
+		RunWorkload(workload, "lazy", lazy, seed, count);
+	}
+	return 0;
+}
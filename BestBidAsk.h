@@ -0,0 +1,11 @@
+#pragma once
+
+#include <optional>
+
+#include "LevelInfo.h"
+
+struct BestBidAsk // the top level of each side, empty while that side has no orders
+{
+    std::optional<LevelInfo> bid_;
+    std::optional<LevelInfo> ask_;
+};
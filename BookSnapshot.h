@@ -0,0 +1,35 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "BestBidAsk.h"
+#include "LevelInfo.h"
+
+// the best levels of both sides in a fixed-size, trivially copyable block, so it can be published through a Seqlock
+// the first entry of each side is L1, all Depth of them L5
+struct BookSnapshot
+{
+    static constexpr std::size_t Depth = 5;
+
+    std::array<LevelInfo, Depth> bids_{}; // best first, only the first bidCount_ are valid
+    std::array<LevelInfo, Depth> asks_{};
+    std::uint32_t bidCount_{};
+    std::uint32_t askCount_{};
+    std::uint64_t version_{}; // bumped on every publish, a reader can tell whether anything changed since its last read
+
+    BestBidAsk Top() const
+    {
+        BestBidAsk top;
+        if (bidCount_)
+        {
+            top.bid_ = bids_[0];
+        }
+        if (askCount_)
+        {
+            top.ask_ = asks_[0];
+        }
+        return top;
+    }
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Order.h"
+#include "OrderModify.h"
+#include "OrderType.h"
+#include "Side.h"
+#include "TradeInfo.h"
+#include "Usings.h"
+
+// a request against a book as plain data, so it can sit in a ring buffer or a batch
+struct Command
+{
+	enum class Type
+	{
+		Add,
+		Cancel,
+		Modify,
+	};
+
+	Type type_{Type::Add};
+	OrderType orderType_{OrderType::GoodTillCancel}; // adds only, a modify keeps the resting order's type
+	OrderId orderId_{};
+	Side side_{Side::Buy};
+	Price price_{};
+	Quantity quantity_{};
+	ExpiryTime expiry_{ExpiryTime::max()}; // good till date adds only
+	Quantity displayQuantity_{};		   // iceberg adds only
+	Price stopPrice_{};					   // stop adds only
+	OwnerId owner_{};					   // adds only, 0 for none
+
+	static Command Add(const Order &order)
+	{
+		return Command{Type::Add, order.GetOrderType(), order.GetOrderID(), order.GetSide(), order.GetPrice(), order.GetInitialQuantity(), order.GetExpiry(),
+					   order.GetDisplayQuantity(), order.GetStopPrice(), order.GetOwner()};
+	}
+	static Command Cancel(OrderId orderId)
+	{
+		return Command{Type::Cancel, OrderType::GoodTillCancel, orderId, Side::Buy, Price{}, Quantity{}, ExpiryTime::max()};
+	}
+	static Command Modify(const OrderModify &order)
+	{
+		return Command{Type::Modify, OrderType::GoodTillCancel, order.GetOrderID(), order.GetSide(), order.GetPrice(), order.GetQuantity(), ExpiryTime::max()};
+	}
+
+	Order ToOrder() const { return Order{orderType_, orderId_, side_, price_, quantity_, expiry_, displayQuantity_, stopPrice_, owner_}; }
+	OrderModify ToOrderModify() const { return OrderModify{orderId_, side_, price_, quantity_}; }
+};
+
+// what the matching thread sends back for a command: one Accepted/Rejected, then its fills
+struct CommandResponse
+{
+	enum class Kind
+	{
+		Accepted,
+		Rejected,
+		Fill,
+	};
+
+	Kind kind_{Kind::Accepted};
+	std::uint64_t sequence_{}; // index of the answered command among its producer's submissions, from 0
+	OrderId orderId_{};		   // the command's order
+	TradeInfo bidTrade_{};	   // fills only
+	TradeInfo askTrade_{};
+};
+
+// the outcome of one command of a batch, its fills are a slice of the batch's trade stream
+struct CommandResult
+{
+	bool applied_{false};
+	std::size_t firstTrade_{}; // the command's fills are trades[firstTrade_, firstTrade_ + tradeCount_)
+	std::size_t tradeCount_{};
+};
+
+using Commands = std::vector<Command>;
+using CommandResults = std::vector<CommandResult>;
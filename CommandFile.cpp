@@ -0,0 +1,109 @@
+#include "CommandFile.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#include "JournalRecord.h"
+
+namespace
+{
+	template <typename T>
+	void Put(std::byte *out, T value)
+	{
+		for (std::size_t i = 0; i < sizeof(T); ++i)
+		{
+			out[i] = static_cast<std::byte>(value >> (8 * i));
+		}
+	}
+	template <typename T>
+	T Get(const std::byte *in)
+	{
+		T value{};
+		for (std::size_t i = 0; i < sizeof(T); ++i)
+		{
+			value |= static_cast<T>(std::to_integer<T>(in[i]) << (8 * i));
+		}
+		return value;
+	}
+
+	void Encode(const Command &command, std::byte *out)
+	{
+		out[0] = static_cast<std::byte>(command.type_);
+		out[1] = static_cast<std::byte>(command.orderType_);
+		out[2] = static_cast<std::byte>(command.side_);
+		out[3] = std::byte{0};
+		Put(out + 4, static_cast<std::uint32_t>(command.price_));
+		Put(out + 8, command.orderId_);
+		Put(out + 16, command.quantity_);
+		Put(out + 20, command.displayQuantity_);
+		Put(out + 24, static_cast<std::uint32_t>(command.stopPrice_));
+		Put(out + 28, command.owner_);
+		Put(out + 32, static_cast<std::uint64_t>(JournalRecord::EncodeExpiry(command.expiry_)));
+	}
+	Command Decode(const std::byte *in)
+	{
+		Command command;
+		command.type_ = static_cast<Command::Type>(in[0]);
+		command.orderType_ = static_cast<OrderType>(in[1]);
+		command.side_ = static_cast<Side>(in[2]);
+		command.price_ = static_cast<Price>(Get<std::uint32_t>(in + 4));
+		command.orderId_ = Get<std::uint64_t>(in + 8);
+		command.quantity_ = Get<std::uint32_t>(in + 16);
+		command.displayQuantity_ = Get<std::uint32_t>(in + 20);
+		command.stopPrice_ = static_cast<Price>(Get<std::uint32_t>(in + 24));
+		command.owner_ = Get<std::uint32_t>(in + 28);
+		command.expiry_ = JournalRecord::DecodeExpiry(static_cast<std::int64_t>(Get<std::uint64_t>(in + 32)));
+		return command;
+	}
+}
+
+void CommandFile::Save(const Commands &commands, const std::string &path)
+{
+	std::vector<std::byte> bytes(sizeof(Magic) + commands.size() * EncodedSize);
+	std::memcpy(bytes.data(), Magic, sizeof(Magic));
+	for (std::size_t i = 0; i < commands.size(); ++i)
+	{
+		Encode(commands[i], bytes.data() + sizeof(Magic) + i * EncodedSize);
+	}
+	const std::string temporary = path + ".tmp";
+	{
+		std::ofstream out{temporary, std::ios::binary | std::ios::trunc};
+		out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		if (!out.flush())
+		{
+			throw std::runtime_error(std::format("Command file {} cannot be written: {}", temporary, std::strerror(errno)));
+		}
+	}
+	if (std::rename(temporary.c_str(), path.c_str()) != 0)
+	{
+		throw std::runtime_error(std::format("Command file {} cannot be renamed to {}: {}", temporary, path, std::strerror(errno)));
+	}
+}
+
+Commands CommandFile::Load(const std::string &path)
+{
+	std::ifstream in{path, std::ios::binary};
+	if (!in)
+	{
+		throw std::runtime_error(std::format("Command file {} cannot be opened: {}", path, std::strerror(errno)));
+	}
+	const std::vector<char> bytes{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+	if (bytes.size() < sizeof(Magic) || std::memcmp(bytes.data(), Magic, sizeof(Magic)) != 0)
+	{
+		throw std::runtime_error(std::format("{} is not a command file", path));
+	}
+	const auto *records = reinterpret_cast<const std::byte *>(bytes.data() + sizeof(Magic));
+	Commands commands((bytes.size() - sizeof(Magic)) / EncodedSize);
+	for (std::size_t i = 0; i < commands.size(); ++i)
+	{
+		commands[i] = Decode(records + i * EncodedSize);
+	}
+	return commands;
+}
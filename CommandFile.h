@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "Command.h"
+
+// a recorded stream of commands, so the same flow can be replayed through any book (see Replay.cpp)
+// layout: an 8 byte magic, then one fixed size record per command, little-endian whatever the host:
+// byte 0 type, 1 order type, 2 side, 3 unused, 4 price, 8 order id, 16 quantity, 20 display quantity, 24 stop price,
+// 28 owner, 32 expiry (nanoseconds since the epoch, see JournalRecord::EncodeExpiry)
+class CommandFile
+{
+public:
+	static constexpr std::size_t EncodedSize = 40;
+
+	// written to path.tmp and renamed over path, like a snapshot
+	static void Save(const Commands &commands, const std::string &path);
+	// every command of the file, decoded up front so a replay times the book and not the disk
+	// throws when the file cannot be read or is not a command file, a torn last record is dropped
+	static Commands Load(const std::string &path);
+
+private:
+	static constexpr char Magic[8] = {'O', 'B', 'C', 'M', 'D', 'S', '0', '1'};
+};
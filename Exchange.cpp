@@ -0,0 +1,271 @@
+#include "Exchange.h"
+
+#include "ThreadAffinity.h"
+
+Exchange::Producer::Producer(const Exchange &exchange, std::size_t workerCount, std::size_t capacity)
+	: exchange_{exchange}
+{
+	for (std::size_t i = 0; i < workerCount; ++i)
+	{
+		commands_.emplace_back(std::make_unique<SpscRing<RoutedCommand>>(capacity));
+		responses_.emplace_back(std::make_unique<SpscRing<RoutedResponse>>(capacity));
+	}
+}
+bool Exchange::Producer::TrySubmit(SymbolId symbolId, const Command &command)
+{
+	if (!commands_[exchange_.WorkerFor(symbolId)]->TryPush(RoutedCommand{symbolId, sequence_, command}))
+	{
+		return false;
+	}
+	++sequence_;
+	return true;
+}
+bool Exchange::Producer::TryPoll(RoutedResponse &response)
+{
+	for (std::size_t i = 0; i < responses_.size(); ++i)
+	{
+		auto &responses = *responses_[nextResponseRing_];
+		nextResponseRing_ = (nextResponseRing_ + 1) % responses_.size();
+		if (responses.TryPop(response))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+Exchange::Exchange(ExchangeConfig config)
+{
+	if (!config.inlineHousekeeping_)
+	{
+		timers_.emplace(config.housekeepingCore_);
+	}
+	const std::size_t workerCount = config.workerCount_ ? config.workerCount_ : 1;
+	const auto coreOf = [&](std::size_t w)
+	{ return w < config.workerCores_.size() ? std::optional<unsigned>{config.workerCores_[w]} : std::nullopt; };
+	for (std::size_t w = 0; w < workerCount; ++w)
+	{
+		// a worker's books are built on its own core with localMemory_, so they are first touched where they are matched
+		const ScopedPin pin{config.localMemory_ ? coreOf(w) : std::nullopt};
+		auto &worker = *workers_.emplace_back(std::make_unique<Worker>(timers_ ? &*timers_ : nullptr));
+		for (std::size_t i = w; i < config.symbols_.size(); i += workerCount) // dealt round-robin, so every worker gets the same number of books
+		{
+			const auto &[symbolId, book] = config.symbols_[i];
+			routes_.emplace(symbolId, w);
+			worker.books_.emplace(symbolId, std::make_unique<Book>(book));
+		}
+	}
+	for (std::size_t p = 0; p < config.producerCount_; ++p)
+	{
+		auto &producer = *producers_.emplace_back(new Producer{*this, workerCount, config.ringCapacity_});
+		for (std::size_t w = 0; w < workerCount; ++w)
+		{
+			workers_[w]->commands_.push_back(producer.commands_[w].get());
+			workers_[w]->responses_.push_back(producer.responses_[w].get());
+		}
+	}
+	for (std::size_t w = 0; w < workerCount; ++w) // started last, a worker must not see a half-built exchange
+	{
+		workers_[w]->Start(coreOf(w));
+	}
+}
+Exchange::~Exchange()
+{
+	// stop the workers while the timer service is still alive, they arm it from their own threads
+	// then stop the timer service while the workers still exist: its pending callbacks point at them, and it is
+	// declared before workers_, so the members alone would destroy it last
+	for (auto &worker : workers_)
+	{
+		worker->Stop();
+	}
+	timers_.reset();
+}
+
+BookSnapshot Exchange::GetSnapshot(SymbolId symbolId) const
+{
+	// the route and book maps are never modified after construction, any thread may look them up
+	auto route = routes_.find(symbolId);
+	if (route == routes_.end())
+	{
+		return BookSnapshot{};
+	}
+	const auto &books = workers_[route->second]->books_;
+	return books.find(symbolId)->second->snapshot_.Load();
+}
+bool Exchange::TryPollDelta(SymbolId symbolId, LevelDelta &delta)
+{
+	auto route = routes_.find(symbolId);
+	if (route == routes_.end())
+	{
+		return false;
+	}
+	return workers_[route->second]->books_.find(symbolId)->second->core_.TryPollDelta(delta);
+}
+bool Exchange::TryPollExecutionReport(SymbolId symbolId, ExecutionReport &report)
+{
+	auto route = routes_.find(symbolId);
+	if (route == routes_.end())
+	{
+		return false;
+	}
+	return workers_[route->second]->books_.find(symbolId)->second->core_.TryPollExecutionReport(report);
+}
+
+std::size_t Exchange::WorkerFor(SymbolId symbolId) const
+{
+	auto route = routes_.find(symbolId);
+	return route == routes_.end() ? symbolId % workers_.size() : route->second; // an unknown symbol still needs a worker to reject it
+}
+
+Exchange::Worker::~Worker()
+{
+	Stop();
+}
+void Exchange::Worker::Stop()
+{
+	shutdown_.store(true, std::memory_order_release);
+	if (thread_.joinable())
+	{
+		thread_.join();
+	}
+}
+void Exchange::Worker::Start(std::optional<unsigned> core)
+{
+	dirty_.reserve(books_.size()); // a book is listed at most once per pass, so publishing never allocates
+	thread_ = std::thread{[this]
+						  { Run(); }};
+	if (core)
+	{
+		PinThread(thread_, *core);
+	}
+}
+void Exchange::Worker::Run()
+{
+	while (!shutdown_.load(std::memory_order_acquire))
+	{
+		const bool busy = DrainProducers();
+		if (!timers_ && armedExpiry_ != ExpiryTime::max() && TimerService::Clock::now() >= armedExpiry_)
+		{
+			expiryDue_.store(true, std::memory_order_relaxed); // what the timer would have done, ExpireBooks watches the next one
+		}
+		if (expiryDue_.load(std::memory_order_relaxed) && expiryDue_.exchange(false, std::memory_order_acq_rel))
+		{
+			ExpireBooks();
+		}
+		PublishSnapshots();
+		if (!busy && !CompactBooks())
+		{
+			std::this_thread::yield(); // nothing queued, give the core to the producers for a moment
+		}
+	}
+	while (DrainProducers()) // the commands submitted before shutdown still get applied
+	{
+		PublishSnapshots();
+	}
+}
+bool Exchange::Worker::DrainProducers()
+{
+	bool busy = false;
+	RoutedCommand routed;
+	for (std::size_t p = 0; p < commands_.size(); ++p)
+	{
+		for (std::size_t i = 0; i < DrainBatch && commands_[p]->TryPop(routed); ++i)
+		{
+			busy = true;
+			const auto &[symbolId, sequence, command] = routed;
+			auto book = books_.find(symbolId);
+			const bool applied = ApplyAndRespond(book != books_.end() ? &book->second->core_ : nullptr, command, sequence, trades_,
+												 [&](const CommandResponse &response)
+												 { PushResponse(*responses_[p], RoutedResponse{symbolId, response}, shutdown_); });
+			if (applied)
+			{
+				MarkDirty(*book->second);
+			}
+			if (applied && command.type_ != Command::Type::Cancel)
+			{
+				if (const auto next = book->second->core_.NextExpiry(); next)
+				{
+					ArmExpiryTimer(*next);
+				}
+			}
+		}
+	}
+	return busy;
+}
+void Exchange::Worker::ArmExpiryTimer(ExpiryTime expiry)
+{
+	if (expiry >= armedExpiry_) // a timer for an earlier or equal deadline is already pending
+	{
+		return;
+	}
+	armedExpiry_ = expiry;
+	if (!timers_) // Run watches armedExpiry_ itself
+	{
+		return;
+	}
+	timers_->Schedule(expiry, [this]
+					 { expiryDue_.store(true, std::memory_order_release); });
+}
+void Exchange::Worker::ExpireBooks()
+{
+	const auto now = TimerService::Clock::now();
+	std::size_t budget = ExpiryChunk;
+	for (auto &[_, book] : books_)
+	{
+		const std::size_t expired = book->core_.ExpireOrders(now, budget);
+		if (expired)
+		{
+			MarkDirty(*book);
+		}
+		budget -= expired;
+		if (budget == 0) // more may be due, carry on in the next pass so the commands keep flowing
+		{
+			expiryDue_.store(true, std::memory_order_relaxed);
+			return;
+		}
+	}
+	// everything due is gone, sleep until the earliest expiry left in the shard
+	armedExpiry_ = ExpiryTime::max();
+	std::optional<ExpiryTime> earliest;
+	for (const auto &[_, book] : books_)
+	{
+		if (const auto next = book->core_.NextExpiry(); next && (!earliest || *next < *earliest))
+		{
+			earliest = next;
+		}
+	}
+	if (earliest)
+	{
+		ArmExpiryTimer(*earliest);
+	}
+}
+std::size_t Exchange::Worker::CompactBooks()
+{
+	std::size_t budget = CompactChunk;
+	for (auto &[_, book] : books_)
+	{
+		budget -= book->core_.CompactLevels(budget); // the book looks the same after, nothing to publish
+		if (budget == 0)
+		{
+			break;
+		}
+	}
+	return CompactChunk - budget;
+}
+void Exchange::Worker::MarkDirty(Book &book)
+{
+	if (book.snapshot_.Enabled() && !book.dirty_)
+	{
+		book.dirty_ = true;
+		dirty_.push_back(&book);
+	}
+}
+void Exchange::Worker::PublishSnapshots()
+{
+	for (Book *book : dirty_)
+	{
+		book->snapshot_.Publish(book->core_);
+		book->dirty_ = false;
+	}
+	dirty_.clear();
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "BookSnapshot.h"
+#include "Command.h"
+#include "ExecutionReport.h"
+#include "LevelDelta.h"
+#include "MatchingLoop.h"
+#include "OrderbookConfig.h"
+#include "OrderbookCore.h"
+#include "SpscRing.h"
+#include "TimerService.h"
+#include "Trade.h"
+#include "Usings.h"
+
+struct SymbolConfig
+{
+	SymbolId symbolId_{};
+	OrderbookConfig book_;
+};
+
+struct ExchangeConfig
+{
+	std::vector<SymbolConfig> symbols_; // the instrument universe, fixed for the exchange's lifetime
+	std::size_t workerCount_{1};		// matching threads, the symbols are spread evenly over them
+	std::size_t producerCount_{1};		// one per gateway thread
+	std::size_t ringCapacity_{1 << 12}; // slots in each producer/worker ring, in each direction
+	std::vector<unsigned> workerCores_; // worker i is pinned to workerCores_[i] when given
+	// the same knobs as ThreadPlacement, with workerCores_ as the matching cores
+	std::optional<unsigned> housekeepingCore_; // the timer thread is pinned here
+	bool localMemory_{false};				   // build each worker's books on its core, so their memory is on its NUMA node
+	bool inlineHousekeeping_{false};		   // no timer thread, each worker checks its shard's earliest expiry once per pass
+};
+
+struct RoutedCommand
+{
+	SymbolId symbolId_{};
+	std::uint64_t sequence_{}; // stamped by the producer, echoed in the responses
+	Command command_;
+};
+
+struct RoutedResponse
+{
+	SymbolId symbolId_{};
+	CommandResponse response_;
+};
+
+// many books sharded over a fixed pool of worker threads
+// each symbol belongs to exactly one worker, which owns its OrderbookCore outright and applies the
+// symbol's commands without a lock; every producer/worker pair has its own pair of SPSC rings
+// expiry comes from one shared TimerService: each worker keeps one timer armed for the earliest expiry
+// of its shard, and when it fires the worker cancels the due orders of its own books on its own thread
+// (with ExchangeConfig::inlineHousekeeping_ there is no timer thread, the worker watches that deadline itself)
+class Exchange
+{
+public:
+	// the endpoint of one producer thread, only that thread may call it
+	class Producer
+	{
+	public:
+		// routes the command to its symbol's worker, false while that worker's ring is full
+		// commands for one symbol are applied in submission order, unknown symbols are rejected
+		bool TrySubmit(SymbolId symbolId, const Command &command);
+		// responses of one symbol arrive in order, responses of different workers interleave
+		// a producer must keep draining, a worker waits for room in a full response ring
+		bool TryPoll(RoutedResponse &response);
+
+	private:
+		friend class Exchange;
+		Producer(const Exchange &exchange, std::size_t workerCount, std::size_t capacity);
+
+		const Exchange &exchange_;
+		std::vector<std::unique_ptr<SpscRing<RoutedCommand>>> commands_;   // one per worker
+		std::vector<std::unique_ptr<SpscRing<RoutedResponse>>> responses_; // one per worker
+		std::uint64_t sequence_{0};
+		std::size_t nextResponseRing_{0}; // polled round-robin so no worker is starved
+	};
+
+	explicit Exchange(ExchangeConfig config);
+	Exchange(const Exchange &) = delete;
+	void operator=(const Exchange &) = delete;
+	Exchange(Exchange &&) = delete;
+	void operator=(Exchange &&) = delete;
+	~Exchange(); // workers apply what is already queued, then are joined
+
+	Producer &GetProducer(std::size_t index) { return *producers_[index]; }
+	std::size_t ProducerCount() const { return producers_.size(); }
+	std::size_t WorkerCount() const { return workers_.size(); }
+	// the top of a symbol's book as of the end of its worker's last pass that touched it, from any thread
+	// only kept up to date for symbols configured with OrderbookConfig::publishSnapshot_, empty (version_ 0) otherwise
+	BookSnapshot GetSnapshot(SymbolId symbolId) const;
+	// the next level change of a symbol's book, one publisher thread per symbol
+	// only fed for symbols configured with OrderbookConfig::deltaRingCapacity_, false for unknown symbols
+	bool TryPollDelta(SymbolId symbolId, LevelDelta &delta);
+	// the next execution report of a symbol's book, one gateway thread per symbol, which splits them into sessions by owner_
+	// only fed for symbols configured with OrderbookConfig::executionReportCapacity_, false for unknown symbols
+	bool TryPollExecutionReport(SymbolId symbolId, ExecutionReport &report);
+
+private:
+	struct Book
+	{
+		explicit Book(const OrderbookConfig &config) : core_{config}, snapshot_{config.publishSnapshot_} {}
+
+		OrderbookCore core_;
+		SnapshotPublisher snapshot_; // written by the owning worker only
+		bool dirty_{false}; // changed during the current pass and not yet published
+	};
+
+	class Worker
+	{
+	public:
+		explicit Worker(TimerService *timers) : timers_{timers} {} // no timers for inline housekeeping
+		Worker(const Worker &) = delete;
+		void operator=(const Worker &) = delete;
+		~Worker();
+
+		void Start(std::optional<unsigned> core);
+		void Stop(); // applies what is already queued, then joins
+
+		std::unordered_map<SymbolId, std::unique_ptr<Book>> books_; // this worker's shard, read-only once built
+		std::vector<SpscRing<RoutedCommand> *> commands_;					  // one per producer
+		std::vector<SpscRing<RoutedResponse> *> responses_;					  // one per producer
+
+	private:
+		static constexpr std::size_t DrainBatch = 64;	 // commands taken from one producer before moving to the next
+		static constexpr std::size_t ExpiryChunk = 256; // expired orders cancelled per pass, over all books of the shard
+		static constexpr std::size_t CompactChunk = 256; // tombstones released per idle pass, over all books of the shard
+
+		void Run();
+		bool DrainProducers(); // one round-robin pass, true if any command was applied
+		void ArmExpiryTimer(ExpiryTime expiry); // make sure the timer fires by expiry
+		void ExpireBooks();
+		std::size_t CompactBooks(); // lazy cancels, only while the shard is idle
+		void MarkDirty(Book &book);
+		void PublishSnapshots(); // once per pass, for the books the pass changed
+
+		std::vector<Book *> dirty_; // books waiting for PublishSnapshots
+
+		Trades trades_; // reused for every command
+		TimerService *timers_;
+		ExpiryTime armedExpiry_{ExpiryTime::max()}; // earliest deadline a timer is pending for (or watched), worker thread only
+		std::atomic<bool> expiryDue_{false};		// set by the timer thread
+		std::atomic<bool> shutdown_{false};
+		std::thread thread_;
+	};
+
+	std::size_t WorkerFor(SymbolId symbolId) const;
+
+	std::optional<TimerService> timers_;			   // built first, the workers arm it; reset by ~Exchange before they go; none for inline housekeeping
+	std::unordered_map<SymbolId, std::size_t> routes_; // symbol to worker index, read-only once built
+	std::vector<std::unique_ptr<Producer>> producers_; // owns the rings, outlives the workers
+	std::vector<std::unique_ptr<Worker>> workers_;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Side.h"
+#include "Usings.h"
+
+// what happened to an order as its owner sees it, so the owner learns where it stands without asking the book
+// every fill yields two, the resting order's then the aggressor's, under the same execId_
+// quantity that leaves an order without trading is reported as cancelled: what an immediate or a market order did not
+// trade, what self-trade prevention cancelled or decremented, and an expiry; a client's own cancel is answered by its command
+// a book has one stream for all its orders, owner_ is what a gateway splits it into sessions by
+struct ExecutionReport
+{
+    enum class Kind : std::uint8_t
+    {
+        Fill,
+        Cancelled,
+    };
+
+    std::uint64_t sequence_{}; // consecutive per book from 1, a gap means reports were dropped on a full ring
+    std::uint64_t execId_{};   // the fill, consecutive per book from 1, 0 for a cancel
+    OrderId orderId_{};
+    OwnerId owner_{}; // 0 for none
+    Kind kind_{Kind::Fill};
+    Side side_{Side::Buy};
+    Price price_{};                  // the fill's price, the order's own for a cancel
+    Quantity lastQuantity_{};        // the fill's quantity, or what was cancelled
+    Quantity leavesQuantity_{};      // still open after it, an iceberg's hidden reserve included
+    Quantity cumulativeQuantity_{};  // filled so far, this fill included
+    bool done_{false};               // nothing is left, the order is out of the book, filled or not
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <map>
+#include <memory_resource>
+
+#include "OrderDetails.h"
+#include "OrderPool.h"
+#include "RestingOrder.h"
+#include "Usings.h"
+
+// the resting orders that expire, bucketed by expiry time
+// every bucket is an intrusive FIFO threaded through the orders' expiry links (in their OrderDetails), so indexing or
+// unindexing an order never allocates once its bucket exists; good for day orders all share the
+// bucket of the close, good till date orders get one bucket per distinct expiry
+// expiring walks only the buckets that are due instead of the whole book
+class ExpiryIndex
+{
+public:
+	ExpiryIndex(OrderPool &pool, std::pmr::memory_resource *resource) : pool_{pool}, buckets_{resource} {}
+
+	bool empty() const { return buckets_.empty(); }
+	ExpiryTime Earliest() const { return buckets_.begin()->first; }
+	RestingOrder *EarliestOrder() const { return buckets_.begin()->second.head_; } // the oldest order of the earliest bucket
+
+	void Insert(RestingOrder *order, ExpiryTime expiry)
+	{
+		OrderDetails &details = pool_.Details(order);
+		details.expiry_ = expiry;
+		Bucket &bucket = buckets_[expiry];
+		details.expiryPrev_ = bucket.tail_;
+		details.expiryNext_ = nullptr;
+		if (bucket.tail_)
+		{
+			pool_.Details(bucket.tail_).expiryNext_ = order;
+		}
+		else
+		{
+			bucket.head_ = order;
+		}
+		bucket.tail_ = order;
+	}
+	// false when the order is not indexed, its bucket goes away with its last order
+	bool Remove(RestingOrder *order)
+	{
+		if (!Contains(order))
+		{
+			return false;
+		}
+		OrderDetails &details = pool_.Details(order);
+		auto bucket = buckets_.find(details.expiry_);
+		if (details.expiryPrev_)
+		{
+			pool_.Details(details.expiryPrev_).expiryNext_ = details.expiryNext_;
+		}
+		else
+		{
+			bucket->second.head_ = details.expiryNext_;
+		}
+		if (details.expiryNext_)
+		{
+			pool_.Details(details.expiryNext_).expiryPrev_ = details.expiryPrev_;
+		}
+		else
+		{
+			bucket->second.tail_ = details.expiryPrev_;
+		}
+		details.expiryPrev_ = details.expiryNext_ = nullptr;
+		if (!bucket->second.head_)
+		{
+			buckets_.erase(bucket);
+		}
+		return true;
+	}
+	// an indexed order is linked behind another one of its bucket or heads it; an order that never expires has no bucket,
+	// the lookup is skipped for it
+	bool Contains(const RestingOrder *order) const
+	{
+		const OrderDetails &details = pool_.Details(order);
+		if (details.expiry_ == ExpiryTime::max())
+		{
+			return false;
+		}
+		if (details.expiryPrev_)
+		{
+			return true;
+		}
+		const auto bucket = buckets_.find(details.expiry_);
+		return bucket != buckets_.end() && bucket->second.head_ == order;
+	}
+
+private:
+	struct Bucket
+	{
+		RestingOrder *head_{nullptr};
+		RestingOrder *tail_{nullptr};
+	};
+
+	OrderPool &pool_; // where the expiry links live
+
+	std::pmr::map<ExpiryTime, Bucket> buckets_; // earliest expiry first
+};
@@ -0,0 +1,192 @@
+#include "Journal.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "OrderbookCore.h"
+
+Journal::Journal(const std::string &path, JournalConfig config)
+	: config_{config},
+	  records_{config.ringCapacity_}
+{
+	fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (fd_ < 0)
+	{
+		throw std::runtime_error(std::format("Journal {} cannot be opened: {}", path, std::strerror(errno)));
+	}
+	struct stat status;
+	if (::fstat(fd_, &status) != 0)
+	{
+		::close(fd_);
+		throw std::runtime_error(std::format("Journal {} cannot be read: {}", path, std::strerror(errno)));
+	}
+	const auto size = static_cast<std::size_t>(status.st_size);
+	if (size < sizeof(Magic)) // a new journal, or one that crashed before its header was out
+	{
+		if (::ftruncate(fd_, 0) != 0 || !WriteAll(reinterpret_cast<const std::byte *>(Magic), sizeof(Magic)))
+		{
+			::close(fd_);
+			throw std::runtime_error(std::format("Journal {} cannot be written: {}", path, std::strerror(errno)));
+		}
+	}
+	else if (const std::size_t torn = (size - sizeof(Magic)) % JournalRecord::EncodedSize; torn) // cut the torn tail, or every later record would be misaligned
+	{
+		if (::ftruncate(fd_, static_cast<off_t>(size - torn)) != 0)
+		{
+			::close(fd_);
+			throw std::runtime_error(std::format("Journal {} cannot be repaired: {}", path, std::strerror(errno)));
+		}
+	}
+	existing_ = size < sizeof(Magic) ? 0 : (size - sizeof(Magic)) / JournalRecord::EncodedSize;
+	buffer_.resize(std::max(config_.batchBytes_, JournalRecord::EncodedSize));
+	writer_ = std::thread{[this]
+						  { Run(); }};
+}
+Journal::~Journal()
+{
+	shutdown_.store(true, std::memory_order_release);
+	writer_.join(); // the writer drains the ring before it returns
+	::close(fd_);
+}
+
+void Journal::Append(const JournalRecord &record)
+{
+	while (!records_.TryPush(record)) // never drop a record, wait for the writer to make room
+	{
+		std::this_thread::yield();
+	}
+	appended_.store(appended_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+void Journal::Flush()
+{
+	const std::uint64_t target = appended_.load(std::memory_order_acquire);
+	while (written_.load(std::memory_order_acquire) < target && !Failed())
+	{
+		std::this_thread::yield();
+	}
+}
+
+void Journal::Run()
+{
+	JournalRecord record;
+	while (true)
+	{
+		const bool stopping = shutdown_.load(std::memory_order_acquire); // read before draining, so nothing appended earlier is left behind
+		std::size_t used = 0;
+		std::uint64_t count = 0;
+		while (used + JournalRecord::EncodedSize <= buffer_.size() && records_.TryPop(record))
+		{
+			record.Encode(buffer_.data() + used);
+			used += JournalRecord::EncodedSize;
+			++count;
+		}
+		if (count)
+		{
+			// once a write failed the records are still drained, so the book never waits on a dead journal
+			if (!Failed() && (!WriteAll(buffer_.data(), used) || (config_.sync_ && ::fdatasync(fd_) != 0)))
+			{
+				failed_.store(true, std::memory_order_release);
+			}
+			written_.fetch_add(count, std::memory_order_release);
+			continue;
+		}
+		if (stopping)
+		{
+			return;
+		}
+		std::this_thread::sleep_for(config_.idleWait_); // nothing to write, the next batch gathers meanwhile
+	}
+}
+bool Journal::WriteAll(const std::byte *data, std::size_t size)
+{
+	while (size)
+	{
+		const ssize_t written = ::write(fd_, data, size);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return false;
+		}
+		data += written;
+		size -= static_cast<std::size_t>(written);
+	}
+	return true;
+}
+
+std::size_t Journal::Replay(const std::string &path, OrderbookCore &core, std::uint64_t fromRecord)
+{
+	const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		throw std::runtime_error(std::format("Journal {} cannot be opened: {}", path, std::strerror(errno)));
+	}
+	// read in large chunks, a record may straddle two of them
+	std::vector<std::byte> buffer(1 << 20);
+	std::size_t filled = 0;
+	bool header = true;
+	std::size_t applied = 0;
+	while (true)
+	{
+		const ssize_t bytes = ::read(fd, buffer.data() + filled, buffer.size() - filled);
+		if (bytes < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			const int error = errno;
+			::close(fd);
+			throw std::runtime_error(std::format("Journal {} cannot be read: {}", path, std::strerror(error)));
+		}
+		filled += static_cast<std::size_t>(bytes);
+		std::size_t offset = 0;
+		if (header)
+		{
+			if (filled < sizeof(Magic) && bytes != 0)
+			{
+				continue;
+			}
+			if (filled < sizeof(Magic) || std::memcmp(buffer.data(), Magic, sizeof(Magic)) != 0)
+			{
+				::close(fd);
+				throw std::runtime_error(std::format("{} is not a journal", path));
+			}
+			offset = sizeof(Magic);
+			header = false;
+			if (fromRecord) // past the covered records, the header is checked already
+			{
+				const auto skip = static_cast<off_t>(sizeof(Magic) + fromRecord * JournalRecord::EncodedSize);
+				if (::lseek(fd, skip, SEEK_SET) < 0)
+				{
+					const int error = errno;
+					::close(fd);
+					throw std::runtime_error(std::format("Journal {} cannot be read: {}", path, std::strerror(error)));
+				}
+				filled = 0;
+				continue;
+			}
+		}
+		for (; offset + JournalRecord::EncodedSize <= filled; offset += JournalRecord::EncodedSize)
+		{
+			applied += core.Restore(JournalRecord::Decode(buffer.data() + offset));
+		}
+		if (bytes == 0) // end of file, anything left over is a torn record
+		{
+			break;
+		}
+		std::memmove(buffer.data(), buffer.data() + offset, filled - offset);
+		filled -= offset;
+	}
+	::close(fd);
+	return applied;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "JournalRecord.h"
+#include "SpscRing.h"
+
+class OrderbookCore;
+
+struct JournalConfig
+{
+	std::size_t ringCapacity_{1 << 16};					// records in flight between the book and the writer
+	std::size_t batchBytes_{1 << 20};					// bytes the writer gathers before one write call
+	std::chrono::microseconds idleWait_{100};			// how long the writer sleeps when the ring runs dry
+	bool sync_{false};									// fdatasync after every write, for power-loss durability
+};
+
+// append-only binary journal of one book, written off the book's thread
+// the book appends records to a ring (the book's thread is the one producer, OrderbookConfig::journal_),
+// a writer thread encodes them into a large buffer and hands it to the kernel in a single write, so the
+// matching thread never makes a system call; nothing is ever dropped, a full ring holds the book until the writer catches up
+// the file starts with a magic header and is followed by JournalRecord::EncodedSize byte records
+class Journal
+{
+public:
+	explicit Journal(const std::string &path, JournalConfig config = {}); // appends to an existing journal
+	Journal(const Journal &) = delete;
+	void operator=(const Journal &) = delete;
+	Journal(Journal &&) = delete;
+	void operator=(Journal &&) = delete;
+	~Journal(); // writes everything appended so far, then closes the file
+
+	void Append(const JournalRecord &record); // the book's thread only
+	void Flush();							  // returns once every record appended so far is written (and synced with sync_)
+	bool Failed() const { return failed_.load(std::memory_order_acquire); } // a write failed, the journal stopped writing
+	// records in the journal once everything appended so far is written, the book's thread only
+	// a snapshot taken now covers exactly this many records, replay the rest from here
+	std::uint64_t Position() const { return existing_ + appended_.load(std::memory_order_relaxed); }
+
+	// rebuild a book from a journal file: every record is applied directly to the book (OrderbookCore::Restore),
+	// with no matching and no checks, returns the number of records applied
+	// fromRecord skips the records a snapshot already covers (see Position), the replay seeks straight past them
+	// a torn record at the end of the file (a crash mid-write) is ignored, a file that is not a journal throws
+	static std::size_t Replay(const std::string &path, OrderbookCore &core, std::uint64_t fromRecord = 0);
+
+private:
+	static constexpr char Magic[8] = {'O', 'B', 'J', 'R', 'N', 'L', '0', '2'}; // 02: adds carry the owner
+
+	void Run();
+	bool WriteAll(const std::byte *data, std::size_t size);
+
+	int fd_{-1};
+	const JournalConfig config_;
+	SpscRing<JournalRecord> records_;
+	std::vector<std::byte> buffer_;		  // writer thread only
+	std::uint64_t existing_{0};			  // records the file held when it was opened
+	std::atomic<std::uint64_t> appended_{0}; // bumped by the book's thread
+	std::atomic<std::uint64_t> written_{0};	 // bumped by the writer once the records are in the file
+	std::atomic<bool> failed_{false};
+	std::atomic<bool> shutdown_{false};
+	std::thread writer_; // declared last, it starts in the constructor and uses everything above
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "Order.h"
+#include "OrderType.h"
+#include "Side.h"
+#include "Trade.h"
+#include "Usings.h"
+
+// one change of a book as the journal stores it
+// the journal holds what the book did rather than what it was asked, so replay needs no matching:
+// each fill, an add for every order that came to rest (after the fills it took on arrival), each cancel
+// (by a client or an expiry) and each in-place amend
+// an order that never rests (a market or an immediate order, or one fully filled on arrival) has no add:
+// its fills name it and replay only reduces the resting side
+struct JournalRecord
+{
+	enum class Kind : std::uint8_t
+	{
+		Add,
+		Fill,
+		Cancel,
+		Amend,
+	};
+
+	Kind kind_{Kind::Add};
+	Side side_{Side::Buy};
+	OrderType orderType_{OrderType::GoodTillCancel};
+	Price price_{};
+	OrderId orderId_{};		 // the fill's bid
+	OrderId otherOrderId_{}; // the fill's ask
+	Quantity quantity_{};	 // add: initial, fill: traded, amend: the new remaining quantity
+	ExpiryTime expiry_{ExpiryTime::max()}; // add: when the order expires, the close for a good for day order
+	Quantity remaining_{};				   // add: what it rests with, 0 when that is all of quantity_
+	Quantity display_{};				   // add: an iceberg's display quantity, 0 for other types
+	Price stopPrice_{};					   // add: a stop order's stop price, it waits in the stop index
+	OwnerId owner_{};					   // add: the order's owner, for self-trade prevention once it rests
+
+	static JournalRecord Add(const Order &order)
+	{
+		return JournalRecord{Kind::Add, order.GetSide(), order.GetOrderType(), order.GetPrice(), order.GetOrderID(), OrderId{}, order.GetInitialQuantity(), order.GetExpiry(),
+							 order.GetRemainingQuantity() == order.GetInitialQuantity() ? Quantity{} : order.GetRemainingQuantity(), order.GetDisplayQuantity(),
+							 order.GetStopPrice(), order.GetOwner()};
+	}
+	static JournalRecord Fill(const Trade &trade)
+	{
+		return JournalRecord{Kind::Fill, Side::Buy, OrderType::GoodTillCancel, Price{}, trade.GetBidTrade().orderId_, trade.GetAskTrade().orderId_, trade.GetBidTrade().quantity_, ExpiryTime::max()};
+	}
+	static JournalRecord Cancel(OrderId orderId)
+	{
+		return JournalRecord{Kind::Cancel, Side::Buy, OrderType::GoodTillCancel, Price{}, orderId, OrderId{}, Quantity{}, ExpiryTime::max()};
+	}
+	static JournalRecord Amend(OrderId orderId, Quantity remaining)
+	{
+		return JournalRecord{Kind::Amend, Side::Buy, OrderType::GoodTillCancel, Price{}, orderId, OrderId{}, remaining, ExpiryTime::max()};
+	}
+
+	Order ToOrder() const { return Order{orderType_, orderId_, side_, price_, quantity_, expiry_, display_, stopPrice_, owner_}; }
+
+	// the on-disk form: fixed size, little-endian whatever the host, the expiry as nanoseconds since the epoch
+	// byte 0 kind, 1 side, 2 order type, 3 unused, 4 price, 8 order id, 16 other order id (an add has none, it keeps
+	// its display quantity at 16 and its stop price at 20 instead), 24 quantity, 28 add remaining, 32 expiry,
+	// 40 add owner, 44 unused
+	static constexpr std::size_t EncodedSize = 48;
+
+	void Encode(std::byte *out) const
+	{
+		out[0] = static_cast<std::byte>(kind_);
+		out[1] = static_cast<std::byte>(side_);
+		out[2] = static_cast<std::byte>(orderType_);
+		out[3] = std::byte{0};
+		Put(out + 4, static_cast<std::uint32_t>(price_));
+		Put(out + 8, orderId_);
+		if (kind_ == Kind::Add)
+		{
+			Put(out + 16, display_);
+			Put(out + 20, static_cast<std::uint32_t>(stopPrice_));
+		}
+		else
+		{
+			Put(out + 16, otherOrderId_);
+		}
+		Put(out + 24, quantity_);
+		Put(out + 28, remaining_);
+		Put(out + 32, static_cast<std::uint64_t>(EncodeExpiry(expiry_)));
+		Put(out + 40, kind_ == Kind::Add ? owner_ : OwnerId{});
+		Put(out + 44, std::uint32_t{0});
+	}
+	static JournalRecord Decode(const std::byte *in)
+	{
+		JournalRecord record;
+		record.kind_ = static_cast<Kind>(in[0]);
+		record.side_ = static_cast<Side>(in[1]);
+		record.orderType_ = static_cast<OrderType>(in[2]);
+		record.price_ = static_cast<Price>(Get<std::uint32_t>(in + 4));
+		record.orderId_ = Get<std::uint64_t>(in + 8);
+		if (record.kind_ == Kind::Add)
+		{
+			record.display_ = Get<std::uint32_t>(in + 16);
+			record.stopPrice_ = static_cast<Price>(Get<std::uint32_t>(in + 20));
+			record.owner_ = Get<std::uint32_t>(in + 40);
+		}
+		else
+		{
+			record.otherOrderId_ = Get<std::uint64_t>(in + 16);
+		}
+		record.quantity_ = Get<std::uint32_t>(in + 24);
+		record.remaining_ = Get<std::uint32_t>(in + 28);
+		record.expiry_ = DecodeExpiry(static_cast<std::int64_t>(Get<std::uint64_t>(in + 32)));
+		return record;
+	}
+
+	// nanoseconds since the epoch, the one form every file of the book stores a time in
+	static constexpr std::int64_t NoExpiry = std::numeric_limits<std::int64_t>::max();
+	static std::int64_t EncodeExpiry(ExpiryTime expiry)
+	{
+		return expiry == ExpiryTime::max() ? NoExpiry : std::chrono::duration_cast<std::chrono::nanoseconds>(expiry.time_since_epoch()).count();
+	}
+	static ExpiryTime DecodeExpiry(std::int64_t nanoseconds)
+	{
+		return nanoseconds == NoExpiry ? ExpiryTime::max()
+									   : ExpiryTime{std::chrono::duration_cast<ExpiryTime::duration>(std::chrono::nanoseconds{nanoseconds})};
+	}
+
+private:
+	template <typename T>
+	static void Put(std::byte *out, T value)
+	{
+		for (std::size_t i = 0; i < sizeof(T); ++i)
+		{
+			out[i] = static_cast<std::byte>(value >> (8 * i));
+		}
+	}
+	template <typename T>
+	static T Get(const std::byte *in)
+	{
+		T value{};
+		for (std::size_t i = 0; i < sizeof(T); ++i)
+		{
+			value |= static_cast<T>(std::to_integer<T>(in[i]) << (8 * i));
+		}
+		return value;
+	}
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+// HDR-style log-linear histogram of non-negative samples (ticks, see ReadTicks)
+// every power of two is split into SubBuckets equal buckets, so a value is kept to within 1/SubBuckets of itself
+// over the whole 64-bit range, in a fixed array: recording is a bit scan and an increment, it never allocates
+class LatencyHistogram
+{
+public:
+	void Record(std::uint64_t value)
+	{
+		++counts_[BucketOf(value)];
+		++count_;
+		max_ = std::max(max_, value);
+	}
+	void Merge(const LatencyHistogram &other)
+	{
+		for (std::size_t bucket = 0; bucket < BucketCount; ++bucket)
+		{
+			counts_[bucket] += other.counts_[bucket];
+		}
+		count_ += other.count_;
+		max_ = std::max(max_, other.max_);
+	}
+
+	std::uint64_t Count() const { return count_; }
+	std::uint64_t Max() const { return max_; }
+	// the smallest value of the bucket holding the sample at this fraction (0.5 median, 0.99 p99), 0 when empty
+	std::uint64_t Percentile(double fraction) const
+	{
+		if (!count_)
+		{
+			return 0;
+		}
+		const auto rank = static_cast<std::uint64_t>(fraction * static_cast<double>(count_ - 1));
+		std::uint64_t seen = 0;
+		for (std::size_t bucket = 0; bucket < BucketCount; ++bucket)
+		{
+			seen += counts_[bucket];
+			if (seen > rank)
+			{
+				return LowestOf(bucket);
+			}
+		}
+		return max_;
+	}
+
+private:
+	static constexpr int SubBucketBits = 4;
+	static constexpr std::uint64_t SubBuckets = std::uint64_t{1} << SubBucketBits;
+	// values below SubBuckets map one to one, every power of two above them gets SubBuckets buckets
+	static constexpr std::size_t BucketCount = (64 - SubBucketBits + 1) * SubBuckets;
+
+	static std::size_t BucketOf(std::uint64_t value)
+	{
+		if (value < SubBuckets)
+		{
+			return static_cast<std::size_t>(value);
+		}
+		const int shift = std::bit_width(value) - 1 - SubBucketBits; // keeps the top SubBucketBits + 1 bits
+		return static_cast<std::size_t>((shift + 1) * SubBuckets + ((value >> shift) - SubBuckets));
+	}
+	static std::uint64_t LowestOf(std::size_t bucket)
+	{
+		if (bucket < SubBuckets)
+		{
+			return bucket;
+		}
+		const auto shift = static_cast<int>(bucket / SubBuckets) - 1;
+		return (SubBuckets + bucket % SubBuckets) << shift;
+	}
+
+	std::array<std::uint64_t, BucketCount> counts_{};
+	std::uint64_t count_{0};
+	std::uint64_t max_{0};
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Usings.h"
+
+struct LevelData // metadata for each price level
+{
+	Quantity quantity_{};
+	Quantity count_{};
+	bool deltaPending_{false}; // changed by the current command and already queued for a LevelDelta
+
+	enum class Action
+	{
+		Add,
+		Remove,
+		Match,
+		Amend, // a resting order reduced in place, its count stays
+	};
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Side.h"
+#include "Usings.h"
+
+// one L2 market-data update: the new state of a level after a command, in absolute terms
+// a consumer applies it by overwriting its copy of the level, or erasing it when count_ is 0
+struct LevelDelta
+{
+    std::uint64_t sequence_{}; // consecutive per book from 1, a gap means deltas were dropped on a full ring
+    Side side_{Side::Buy};
+    Price price_{};
+    Quantity quantity_{}; // the level's total after the command, 0 once the level is gone
+    Quantity count_{};    // orders resting at the level after the command
+};
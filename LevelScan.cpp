@@ -0,0 +1,249 @@
+#include "LevelScan.h"
+
+#include <atomic>
+#include <bit>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LEVELSCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+	bool ReachesScalar(const Quantity *quantities, std::size_t count, std::uint64_t target)
+	{
+		std::uint64_t total = 0;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			total += quantities[i];
+			if (total >= target)
+			{
+				return true;
+			}
+		}
+		return total >= target;
+	}
+	std::size_t FirstNonZeroScalar(const std::uint64_t *words, std::size_t count)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			if (words[i])
+			{
+				return i;
+			}
+		}
+		return count;
+	}
+	std::size_t LastNonZeroScalar(const std::uint64_t *words, std::size_t count)
+	{
+		for (std::size_t i = count; i-- > 0;)
+		{
+			if (words[i])
+			{
+				return i;
+			}
+		}
+		return count;
+	}
+
+#if defined(LEVELSCAN_X86)
+	// the quantities are widened to 64-bit lanes so a total never wraps (interleaved with zeros, a sum does not care
+	// about lane order), and checked once a block, the tail goes scalar
+	__attribute__((target("avx2"))) bool ReachesAvx2(const Quantity *quantities, std::size_t count, std::uint64_t target)
+	{
+		constexpr std::size_t Block = 32;
+		__m256i totals = _mm256_setzero_si256();
+		std::uint64_t total = 0;
+		std::size_t i = 0;
+		for (; i + Block <= count; i += Block)
+		{
+			for (std::size_t j = i; j < i + Block; j += 8)
+			{
+				const __m256i eight = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(quantities + j));
+				totals = _mm256_add_epi64(totals, _mm256_unpacklo_epi32(eight, _mm256_setzero_si256()));
+				totals = _mm256_add_epi64(totals, _mm256_unpackhi_epi32(eight, _mm256_setzero_si256()));
+			}
+			const __m128i pairs = _mm_add_epi64(_mm256_castsi256_si128(totals), _mm256_extracti128_si256(totals, 1));
+			total = static_cast<std::uint64_t>(_mm_cvtsi128_si64(pairs)) + static_cast<std::uint64_t>(_mm_extract_epi64(pairs, 1));
+			if (total >= target)
+			{
+				return true;
+			}
+		}
+		return ReachesScalar(quantities + i, count - i, target - total);
+	}
+	__attribute__((target("avx2"))) std::size_t FirstNonZeroAvx2(const std::uint64_t *words, std::size_t count)
+	{
+		std::size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m256i four = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + i));
+			if (!_mm256_testz_si256(four, four))
+			{
+				const auto zero = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(four, _mm256_setzero_si256()))));
+				return i + static_cast<std::size_t>(std::countr_zero(~zero & 0xFu));
+			}
+		}
+		return i + FirstNonZeroScalar(words + i, count - i);
+	}
+	__attribute__((target("avx2"))) std::size_t LastNonZeroAvx2(const std::uint64_t *words, std::size_t count)
+	{
+		std::size_t i = count;
+		for (; i >= 4; i -= 4)
+		{
+			const __m256i four = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + i - 4));
+			if (!_mm256_testz_si256(four, four))
+			{
+				const auto zero = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(four, _mm256_setzero_si256()))));
+				return i - 4 + static_cast<std::size_t>(std::bit_width(~zero & 0xFu)) - 1;
+			}
+		}
+		const std::size_t rest = LastNonZeroScalar(words, i);
+		return rest == i ? count : rest;
+	}
+
+	// GCC 12's own AVX-512 intrinsics seed their results with an "undefined" vector and warn about it when inlined
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+	__attribute__((target("avx512f"))) bool ReachesAvx512(const Quantity *quantities, std::size_t count, std::uint64_t target)
+	{
+		constexpr std::size_t Block = 64;
+		__m512i totals = _mm512_setzero_si512();
+		std::uint64_t total = 0;
+		std::size_t i = 0;
+		for (; i + Block <= count; i += Block)
+		{
+			for (std::size_t j = i; j < i + Block; j += 16)
+			{
+				const __m512i sixteen = _mm512_loadu_si512(quantities + j);
+				totals = _mm512_add_epi64(totals, _mm512_unpacklo_epi32(sixteen, _mm512_setzero_si512()));
+				totals = _mm512_add_epi64(totals, _mm512_unpackhi_epi32(sixteen, _mm512_setzero_si512()));
+			}
+			total = static_cast<std::uint64_t>(_mm512_reduce_add_epi64(totals));
+			if (total >= target)
+			{
+				return true;
+			}
+		}
+		return ReachesScalar(quantities + i, count - i, target - total);
+	}
+	__attribute__((target("avx512f"))) std::size_t FirstNonZeroAvx512(const std::uint64_t *words, std::size_t count)
+	{
+		std::size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m512i eight = _mm512_loadu_si512(words + i);
+			if (const unsigned nonZero = _mm512_test_epi64_mask(eight, eight))
+			{
+				return i + static_cast<std::size_t>(std::countr_zero(nonZero));
+			}
+		}
+		return i + FirstNonZeroScalar(words + i, count - i);
+	}
+	__attribute__((target("avx512f"))) std::size_t LastNonZeroAvx512(const std::uint64_t *words, std::size_t count)
+	{
+		std::size_t i = count;
+		for (; i >= 8; i -= 8)
+		{
+			const __m512i eight = _mm512_loadu_si512(words + i - 8);
+			if (const unsigned nonZero = _mm512_test_epi64_mask(eight, eight))
+			{
+				return i - 8 + static_cast<std::size_t>(std::bit_width(nonZero)) - 1;
+			}
+		}
+		const std::size_t rest = LastNonZeroScalar(words, i);
+		return rest == i ? count : rest;
+	}
+#pragma GCC diagnostic pop
+#endif
+
+	struct Kernels
+	{
+		LevelScan::Isa isa_;
+		bool (*reaches_)(const Quantity *, std::size_t, std::uint64_t);
+		std::size_t (*firstNonZero_)(const std::uint64_t *, std::size_t);
+		std::size_t (*lastNonZero_)(const std::uint64_t *, std::size_t);
+	};
+	constexpr Kernels ScalarKernels{LevelScan::Isa::Scalar, ReachesScalar, FirstNonZeroScalar, LastNonZeroScalar};
+#if defined(LEVELSCAN_X86)
+	constexpr Kernels Avx2Kernels{LevelScan::Isa::Avx2, ReachesAvx2, FirstNonZeroAvx2, LastNonZeroAvx2};
+	constexpr Kernels Avx512Kernels{LevelScan::Isa::Avx512, ReachesAvx512, FirstNonZeroAvx512, LastNonZeroAvx512};
+#endif
+
+	const Kernels *Find(LevelScan::Isa isa) // null when the CPU (or the build) does not support isa
+	{
+		switch (isa)
+		{
+		case LevelScan::Isa::Scalar:
+			return &ScalarKernels;
+#if defined(LEVELSCAN_X86)
+		case LevelScan::Isa::Avx2:
+			return __builtin_cpu_supports("avx2") ? &Avx2Kernels : nullptr;
+		case LevelScan::Isa::Avx512:
+			return __builtin_cpu_supports("avx512f") ? &Avx512Kernels : nullptr;
+#endif
+		default:
+			return nullptr;
+		}
+	}
+	// a function local so a book built during static initialisation still finds it set, loaded relaxed on
+	// every scan, which is a plain load; Select may swap it while other threads scan
+	std::atomic<const Kernels *> &Current()
+	{
+		static std::atomic<const Kernels *> current{[]
+													{
+														for (const auto isa : {LevelScan::Isa::Avx512, LevelScan::Isa::Avx2})
+														{
+															if (const Kernels *kernels = Find(isa))
+															{
+																return kernels;
+															}
+														}
+														return &ScalarKernels;
+													}()};
+		return current;
+	}
+	const Kernels &Use() { return *Current().load(std::memory_order_relaxed); }
+}
+
+namespace LevelScan
+{
+	Isa Selected()
+	{
+		return Use().isa_;
+	}
+	bool Select(Isa isa)
+	{
+		const Kernels *kernels = Find(isa);
+		if (kernels)
+		{
+			Current().store(kernels, std::memory_order_relaxed);
+		}
+		return kernels != nullptr;
+	}
+	const char *Name(Isa isa)
+	{
+		switch (isa)
+		{
+		case Isa::Avx2:
+			return "avx2";
+		case Isa::Avx512:
+			return "avx512";
+		default:
+			return "scalar";
+		}
+	}
+
+	bool Reaches(const Quantity *quantities, std::size_t count, std::uint64_t target)
+	{
+		return Use().reaches_(quantities, count, target);
+	}
+	std::size_t FirstNonZero(const std::uint64_t *words, std::size_t count)
+	{
+		return Use().firstNonZero_(words, count);
+	}
+	std::size_t LastNonZero(const std::uint64_t *words, std::size_t count)
+	{
+		return Use().lastNonZero_(words, count);
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Usings.h"
+
+// vector kernels for the ladder's two long scans: the running total of a range of level quantities (a fill or kill
+// check) and the search for the next non-empty word of the occupancy bitmap (every walk over the levels)
+// AVX-512 and AVX2 versions on x86 with a scalar fallback, the best one the CPU supports is picked on first use;
+// each is compiled for its instruction set function by function, so the rest of the build needs no -m flags
+namespace LevelScan
+{
+	enum class Isa
+	{
+		Scalar,
+		Avx2,
+		Avx512,
+	};
+
+	Isa Selected();			   // the kernels in use
+	bool Select(Isa isa);	   // use these instead (benchmarks, checks), false if the CPU does not support them
+	const char *Name(Isa isa); // "scalar", "avx2", "avx512"
+
+	// quantities[0, count) add up to at least target, the total is checked block by block so a scan stops soon after it gets there
+	bool Reaches(const Quantity *quantities, std::size_t count, std::uint64_t target);
+	// the index of the first (last) non-zero word of words[0, count), count when they are all zero
+	std::size_t FirstNonZero(const std::uint64_t *words, std::size_t count);
+	std::size_t LastNonZero(const std::uint64_t *words, std::size_t count);
+}
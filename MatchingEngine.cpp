@@ -0,0 +1,73 @@
+#include "MatchingEngine.h"
+
+#include "ThreadAffinity.h"
+
+MatchingEngine::MatchingEngine(const MatchingEngineConfig &config, const ScopedPin &)
+	: core_{config.book_},
+	  snapshot_{config.book_.publishSnapshot_}
+{
+	producers_.reserve(config.producerCount_);
+	for (std::size_t i = 0; i < config.producerCount_; ++i)
+	{
+		producers_.emplace_back(new Producer{config.ringCapacity_});
+	}
+}
+MatchingEngine::MatchingEngine(MatchingEngineConfig config)
+	: MatchingEngine{config, ScopedPin{config.placement_.localMemory_ ? config.placement_.matchingCore_ : std::nullopt}}
+{
+	matchingThread_ = std::thread{[this]
+								  { Run(); }}; // started last, it must not see a half-built engine
+	if (config.placement_.matchingCore_)
+	{
+		PinThread(matchingThread_, *config.placement_.matchingCore_);
+	}
+}
+MatchingEngine::~MatchingEngine()
+{
+	shutdown_.store(true, std::memory_order_release);
+	matchingThread_.join();
+}
+
+void MatchingEngine::Run()
+{
+	while (!shutdown_.load(std::memory_order_acquire))
+	{
+		bool busy = DrainProducers();
+		// expiry is checked once per pass, so a busy book still expires its orders, one bounded chunk per pass
+		if (const auto next = core_.NextExpiry(); next)
+		{
+			const auto now = std::chrono::system_clock::now();
+			if (now >= *next)
+			{
+				busy |= core_.ExpireOrders(now, ExpiryChunk) > 0;
+			}
+		}
+		if (busy)
+		{
+			snapshot_.Publish(core_);
+		}
+		else if (!core_.CompactLevels(CompactChunk)) // idle time goes to reclaiming lazy cancels first, the book looks the same after
+		{
+			std::this_thread::yield(); // nothing queued, give the core to the producers for a moment
+		}
+	}
+	while (DrainProducers()) // the commands submitted before shutdown still get applied
+	{
+		snapshot_.Publish(core_);
+	}
+}
+bool MatchingEngine::DrainProducers()
+{
+	bool busy = false;
+	Command command;
+	for (auto &producer : producers_)
+	{
+		for (std::size_t i = 0; i < DrainBatch && producer->commands_.TryPop(command); ++i)
+		{
+			busy = true;
+			ApplyAndRespond(&core_, command, producer->sequence_++, trades_, [&](const CommandResponse &response)
+							{ PushResponse(producer->responses_, response, shutdown_); });
+		}
+	}
+	return busy;
+}
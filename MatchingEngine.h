@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "BookSnapshot.h"
+#include "Command.h"
+#include "ExecutionReport.h"
+#include "LevelDelta.h"
+#include "MatchingLoop.h"
+#include "OrderbookConfig.h"
+#include "OrderbookCore.h"
+#include "SpscRing.h"
+#include "ThreadPlacement.h"
+#include "Trade.h"
+
+class ScopedPin;
+
+struct MatchingEngineConfig
+{
+	OrderbookConfig book_;
+	std::size_t producerCount_{1};		  // one per gateway thread, fixed for the engine's lifetime
+	std::size_t ringCapacity_{1 << 12};	  // slots in each command ring and each response ring
+	// the matching thread is pinned to placement_.matchingCore_, and with localMemory_ the book and the rings are built there
+	// the engine has no housekeeping thread, its matching thread already expires and compacts between passes
+	ThreadPlacement placement_;
+};
+
+// lock-free front end for one book
+// every producer thread gets its own command ring and response ring (single producer, single consumer),
+// one matching thread drains the command rings round-robin and applies them to an OrderbookCore it
+// owns outright, so no mutex is ever taken; it also cancels the good for day and good till date orders as they expire
+class MatchingEngine
+{
+public:
+	// the endpoint of one producer thread, only that thread may call it
+	class Producer
+	{
+	public:
+		// false while the command ring is full, poll the responses and retry
+		bool TrySubmit(const Command &command) { return commands_.TryPush(command); }
+		// every command is answered by one Accepted or Rejected response, followed by its fills
+		// a producer must keep draining, the matching thread waits for room in a full response ring
+		bool TryPoll(CommandResponse &response) { return responses_.TryPop(response); }
+
+	private:
+		friend class MatchingEngine;
+		explicit Producer(std::size_t capacity) : commands_{capacity}, responses_{capacity} {}
+
+		SpscRing<Command> commands_;
+		SpscRing<CommandResponse> responses_;
+		std::uint64_t sequence_{0}; // commands applied so far, only touched by the matching thread
+	};
+
+	explicit MatchingEngine(MatchingEngineConfig config = {});
+	// the matching thread holds a pointer to this, so the engine stays where it was built
+	MatchingEngine(const MatchingEngine &) = delete;
+	void operator=(const MatchingEngine &) = delete;
+	MatchingEngine(MatchingEngine &&) = delete;
+	void operator=(MatchingEngine &&) = delete;
+	~MatchingEngine(); // applies what is already queued, then joins the matching thread
+
+	Producer &GetProducer(std::size_t index) { return *producers_[index]; }
+	std::size_t ProducerCount() const { return producers_.size(); }
+	// the top of the book as of the end of the matching thread's last busy pass, from any thread
+	// only kept up to date with OrderbookConfig::publishSnapshot_, empty (version_ 0) otherwise
+	BookSnapshot GetSnapshot() const { return snapshot_.Load(); }
+	// the next level change of the book, from a single market-data publisher thread
+	// only fed with OrderbookConfig::deltaRingCapacity_ set, see OrderbookCore::TryPollDelta
+	bool TryPollDelta(LevelDelta &delta) { return core_.TryPollDelta(delta); }
+	// the next execution report, lock-free, from one gateway thread, which splits the book's stream into sessions by owner_
+	// only fed with OrderbookConfig::executionReportCapacity_ set, see OrderbookCore::TryPollExecutionReport
+	bool TryPollExecutionReport(ExecutionReport &report) { return core_.TryPollExecutionReport(report); }
+
+private:
+	static constexpr std::size_t DrainBatch = 64;	 // commands taken from one producer before moving to the next
+	static constexpr std::size_t ExpiryChunk = 256; // expired orders cancelled per pass
+	static constexpr std::size_t CompactChunk = 256; // tombstones released per idle pass (OrderbookConfig::lazyCancel_)
+
+	MatchingEngine(const MatchingEngineConfig &config, const ScopedPin &); // builds the engine while the pin holds
+	void Run();
+	bool DrainProducers(); // one round-robin pass, true if any command was applied
+
+	OrderbookCore core_;
+	std::vector<std::unique_ptr<Producer>> producers_;
+	Trades trades_; // reused for every command, so matching does not allocate once it has grown
+	SnapshotPublisher snapshot_; // published once per busy pass
+	std::atomic<bool> shutdown_{false};
+	std::thread matchingThread_;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "BookSnapshot.h"
+#include "Command.h"
+#include "OrderbookCore.h"
+#include "Seqlock.h"
+#include "SpscRing.h"
+#include "Trade.h"
+
+// the steps a matching thread takes for every command and every pass, shared by MatchingEngine and the Exchange workers,
+// so the two front ends answer, wait and publish the same way
+
+// applies one command and answers it with one Accepted or Rejected response followed by its fills, handed to respond in order
+// a null core (an Exchange symbol nobody listed) rejects the command; returns whether it was applied
+template <typename Respond>
+bool ApplyAndRespond(OrderbookCore *core, const Command &command, std::uint64_t sequence, Trades &trades, Respond &&respond)
+{
+	trades.clear();
+	const bool applied = core && core->Apply(command, trades);
+	respond(CommandResponse{applied ? CommandResponse::Kind::Accepted : CommandResponse::Kind::Rejected,
+							sequence, command.orderId_, {}, {}});
+	for (const auto &trade : trades)
+	{
+		respond(CommandResponse{CommandResponse::Kind::Fill, sequence, command.orderId_,
+								trade.GetBidTrade(), trade.GetAskTrade()});
+	}
+	return applied;
+}
+
+// waits for room in a producer's response ring, the producer keeps draining it
+// gives up once shutdown is set, nobody may be left to drain it
+template <typename T>
+void PushResponse(SpscRing<T> &responses, const T &response, const std::atomic<bool> &shutdown)
+{
+	while (!responses.TryPush(response))
+	{
+		if (shutdown.load(std::memory_order_acquire))
+		{
+			return;
+		}
+		std::this_thread::yield();
+	}
+}
+
+// the top of one book as its matching thread last published it, read from any thread
+// publishing is left to the pass rather than done per command, a burst costs one publish
+class SnapshotPublisher
+{
+public:
+	explicit SnapshotPublisher(bool enabled) : enabled_{enabled} {} // OrderbookConfig::publishSnapshot_
+
+	bool Enabled() const { return enabled_; }
+	BookSnapshot Load() const { return snapshot_.Load(); } // empty (version_ 0) until the first publish
+	void Publish(const OrderbookCore &core) // matching thread only
+	{
+		if (!enabled_)
+		{
+			return;
+		}
+		BookSnapshot snapshot = core.GetSnapshot();
+		snapshot.version_ = ++version_;
+		snapshot_.Store(snapshot);
+	}
+
+private:
+	const bool enabled_;
+	Seqlock<BookSnapshot> snapshot_;
+	std::uint64_t version_{0};
+};
@@ -2,25 +2,54 @@
 
 #include <exception>
 #include <format>
-#include <list>
+#include <memory>
+#include <stdexcept>
 
 #include "Constants.h"
 #include "OrderType.h"
 #include "Side.h"
 #include "Usings.h"
 
+// an order as clients hand it in and read it back, the book rests its own split copy (RestingOrder, OrderDetails)
 class Order
 {
 public:
 	Order(OrderType orderType, OrderId orderId, Side side, Price price, Quantity quantity)
 		: orderType_{orderType}, orderId_{orderId}, side_{side}, price_{price},
 		  initialQuantity_{quantity}, remainingQuantity_{quantity} {}
+	Order(OrderType orderType, OrderId orderId, Side side, Price price, Quantity quantity, ExpiryTime expiry)
+		: Order(orderType, orderId, side, price, quantity) { expiry_ = expiry; } // for good till date orders
+	Order(OrderType orderType, OrderId orderId, Side side, Price price, Quantity quantity, Quantity displayQuantity)
+		: Order(orderType, orderId, side, price, quantity) { displayQuantity_ = displayQuantity; } // for iceberg orders
+	// every field, as a book stores an order
+	Order(OrderType orderType, OrderId orderId, Side side, Price price, Quantity quantity, ExpiryTime expiry, Quantity displayQuantity, Price stopPrice = {}, OwnerId owner = {})
+		: Order(orderType, orderId, side, price, quantity, expiry)
+	{
+		displayQuantity_ = displayQuantity;
+		stopPrice_ = stopPrice;
+		owner_ = owner;
+	}
 	Order(OrderId orderId, Side side, Quantity quantity)
 		: Order(OrderType::Market, orderId, side, Constants::InitialPrice, quantity) {} // for market orders, we don't care about the price, just the quantity and side
+	// stop orders, named rather than overloaded: a stop price and a display quantity would be one int literal apart
+	static Order Stop(OrderId orderId, Side side, Price stopPrice, Quantity quantity)
+	{
+		return Order{OrderType::Stop, orderId, side, Constants::InitialPrice, quantity, ExpiryTime::max(), Quantity{}, stopPrice};
+	}
+	static Order StopLimit(OrderId orderId, Side side, Price stopPrice, Price price, Quantity quantity)
+	{
+		return Order{OrderType::StopLimit, orderId, side, price, quantity, ExpiryTime::max(), Quantity{}, stopPrice};
+	}
 	OrderId GetOrderID() const { return orderId_; }
 	Side GetSide() const { return side_; }
 	Price GetPrice() const { return price_; }
 	OrderType GetOrderType() const { return orderType_; }
+	ExpiryTime GetExpiry() const { return expiry_; } // ExpiryTime::max() when the order never expires
+	bool HasExpiry() const { return expiry_ != ExpiryTime::max(); }
+	Quantity GetDisplayQuantity() const { return displayQuantity_; } // the peak an iceberg order shows at a time, 0 for other types
+	Price GetStopPrice() const { return stopPrice_; }				 // the last trade price that releases a stop order
+	OwnerId GetOwner() const { return owner_; }						 // what self-trade prevention compares, 0 for none
+	void SetOwner(OwnerId owner) { owner_ = owner; }
 	Quantity GetInitialQuantity() const { return initialQuantity_; }
 	Quantity GetRemainingQuantity() const { return remainingQuantity_; }
 	Quantity GetFilledQuantity() const
@@ -38,6 +67,17 @@ public:
 		}
 		remainingQuantity_ -= quantity;
 	}
+	void Amend(Quantity remainingQuantity) // reduce-only, the filled quantity stays what it was
+	{
+		if (remainingQuantity > GetRemainingQuantity())
+		{
+			throw std::logic_error(std::format(
+				"Order {} can only be amended down in place",
+				GetOrderID()));
+		}
+		initialQuantity_ -= GetRemainingQuantity() - remainingQuantity;
+		remainingQuantity_ = remainingQuantity;
+	}
 
 private:
 	OrderType orderType_;
@@ -46,13 +86,12 @@ private:
 	Price price_;
 	Quantity initialQuantity_;
 	Quantity remainingQuantity_;
+	ExpiryTime expiry_{ExpiryTime::max()}; // good for day orders get theirs from the book when they rest
+	Quantity displayQuantity_{};
+	Price stopPrice_{};
+	OwnerId owner_{};
 };
 
 using OrderPointer =
-	std::shared_ptr<Order>; // since a order can be stored in multiple data
-							// structures (like bids and asks based, or a whole
-							// orderbook dict)
-using OrderPointers =
-	std::list<OrderPointer>; // iterator cannot be invalidated (despite that the
-							 // memory is not contiguous (since list is a double
-							 // linked list))
+	std::shared_ptr<Order>; // kept for callers that build orders on the heap, the orderbook copies
+							// the order into its own pool, the shared pointer is not retained
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "OrderType.h"
+#include "Side.h"
+#include "Usings.h"
+
+class RestingOrder;
+
+// the part of a resting order matching does not read while the order trades, kept by OrderPool next to (not inside)
+// its RestingOrder; a sweep only looks here once an order is filled, as it releases it (or refills an iceberg)
+struct OrderDetails
+{
+	Price price_{};
+	Quantity initialQuantity_{};
+	Side side_{Side::Buy};
+	OrderType orderType_{OrderType::GoodTillCancel};
+	ExpiryTime expiry_{ExpiryTime::max()}; // good for day orders get theirs from the book when they rest
+	// an iceberg shows its quantity peak_ at a time, the RestingOrder holds the slice on show and reserve_ the rest
+	// the slice is always what is left of the current peak-sized slice, counted from the order's first unit:
+	// min(remaining, peak_ - filled % peak_), so it follows from the order's quantities (see SplitIceberg)
+	Quantity peak_{};	 // 0 for every other type, the whole order shows
+	Quantity reserve_{}; // hidden behind the slice, not in the level totals
+	Price stopPrice_{};	 // a stop order waits in the stop index until the last trade price reaches this
+	OwnerId owner_{};	 // only read by a sweep with self-trade prevention, as it meets the order
+	// links of the expiry bucket the order waits in, see ExpiryIndex
+	RestingOrder *expiryPrev_{nullptr};
+	RestingOrder *expiryNext_{nullptr};
+};
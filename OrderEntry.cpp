@@ -0,0 +1,83 @@
+#include "OrderEntry.h"
+
+#include "JournalRecord.h"
+
+namespace
+{
+	template <typename T>
+	void Put(std::byte *out, T value)
+	{
+		for (std::size_t i = 0; i < sizeof(T); ++i)
+		{
+			out[i] = static_cast<std::byte>(value >> (8 * i));
+		}
+	}
+
+	std::size_t SizeOf(Command::Type type)
+	{
+		switch (type)
+		{
+		case Command::Type::Add:
+			return OrderEntry::AddSize;
+		case Command::Type::Cancel:
+			return OrderEntry::CancelSize;
+		case Command::Type::Modify:
+			return OrderEntry::ModifySize;
+		}
+		return 0;
+	}
+}
+
+OrderEntry::Writer::Writer(std::uint64_t sequence) : sequence_{sequence}
+{
+	packet_.reserve(MaxPacketSize);
+	Clear();
+}
+void OrderEntry::Writer::Clear()
+{
+	sequence_ += count_;
+	count_ = 0;
+	packet_.assign(HeaderSize, std::byte{0});
+	Put(packet_.data(), sequence_);
+}
+bool OrderEntry::Writer::Append(const Command &command)
+{
+	const std::size_t size = SizeOf(command.type_);
+	if (packet_.size() + LengthSize + size > MaxPacketSize)
+	{
+		return false;
+	}
+	const std::size_t offset = packet_.size();
+	packet_.resize(offset + LengthSize + size); // within the reserved packet, never reallocates
+	std::byte *out = packet_.data() + offset;
+	Put(out, static_cast<std::uint16_t>(size));
+	out += LengthSize;
+	switch (command.type_)
+	{
+	case Command::Type::Add:
+		out[0] = static_cast<std::byte>(Message::Add);
+		out[1] = static_cast<std::byte>(command.orderType_);
+		out[2] = static_cast<std::byte>(command.side_);
+		Put(out + 4, static_cast<std::uint32_t>(command.price_));
+		Put(out + 8, command.orderId_);
+		Put(out + 16, command.quantity_);
+		Put(out + 20, command.displayQuantity_);
+		Put(out + 24, static_cast<std::uint32_t>(command.stopPrice_));
+		Put(out + 28, command.owner_);
+		Put(out + 32, static_cast<std::uint64_t>(JournalRecord::EncodeExpiry(command.expiry_)));
+		break;
+	case Command::Type::Cancel:
+		out[0] = static_cast<std::byte>(Message::Cancel);
+		Put(out + 8, command.orderId_);
+		break;
+	case Command::Type::Modify:
+		out[0] = static_cast<std::byte>(Message::Modify);
+		out[2] = static_cast<std::byte>(command.side_);
+		Put(out + 4, static_cast<std::uint32_t>(command.price_));
+		Put(out + 8, command.orderId_);
+		Put(out + 16, command.quantity_);
+		break;
+	}
+	Put(packet_.data() + 8, ++count_);
+	return true;
+}
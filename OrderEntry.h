@@ -0,0 +1,225 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#include "Command.h"
+#include "JournalRecord.h"
+#include "OrderType.h"
+#include "Side.h"
+#include "Usings.h"
+
+// the binary order-entry protocol: fixed-layout messages, little-endian whatever the host, framed the way MoldUDP64 frames ITCH
+// packet: byte 0 the sequence number of its first message, 8 the message count, 10 the messages, each after its 2 byte length
+// messages (offsets within the message):
+//   add    'A': 0 type, 1 order type, 2 side, 3 unused, 4 price, 8 order id, 16 quantity, 20 display quantity, 24 stop price,
+//               28 owner, 32 expiry (nanoseconds since the epoch, see JournalRecord::EncodeExpiry), 40 bytes
+//   cancel 'X': 0 type, 1 unused, 8 order id, 16 bytes
+//   modify 'U': 0 type, 1 unused, 2 side, 3 unused, 4 price, 8 order id, 16 quantity, 20 bytes
+// a message longer than its layout is read up to the layout and the rest skipped, so fields can be appended the way SBE
+// extends a block without breaking older readers; a message of an unknown type is skipped whole
+// the reader hands each message out as a view over the packet with the getters of an Order (or an OrderModify), the book
+// takes it as it is (OrderbookCore::Apply), nothing is copied out of the receive buffer on the way to the order pool
+class OrderEntry
+{
+public:
+	enum class Message : std::uint8_t
+	{
+		Add = 'A',
+		Cancel = 'X',
+		Modify = 'U',
+	};
+
+	static constexpr std::size_t HeaderSize = 10;
+	static constexpr std::size_t LengthSize = 2;
+	static constexpr std::size_t AddSize = 40;
+	static constexpr std::size_t CancelSize = 16;
+	static constexpr std::size_t ModifySize = 20;
+	static constexpr std::size_t MaxPacketSize = 1472; // the UDP payload of one Ethernet frame
+
+	// the views stay valid as long as the packet does; each getter is a load from the packet
+	class AddMessage
+	{
+	public:
+		explicit AddMessage(const std::byte *in) : in_{in} {}
+
+		OrderType GetOrderType() const { return static_cast<OrderType>(in_[1]); }
+		OrderId GetOrderID() const { return Load<std::uint64_t>(in_ + 8); }
+		Side GetSide() const { return static_cast<Side>(in_[2]); }
+		Price GetPrice() const { return static_cast<Price>(Load<std::uint32_t>(in_ + 4)); }
+		Quantity GetInitialQuantity() const { return Load<std::uint32_t>(in_ + 16); }
+		Quantity GetDisplayQuantity() const { return Load<std::uint32_t>(in_ + 20); }
+		Price GetStopPrice() const { return static_cast<Price>(Load<std::uint32_t>(in_ + 24)); }
+		OwnerId GetOwner() const { return Load<std::uint32_t>(in_ + 28); }
+		ExpiryTime GetExpiry() const { return JournalRecord::DecodeExpiry(static_cast<std::int64_t>(Load<std::uint64_t>(in_ + 32))); }
+		bool HasExpiry() const { return static_cast<std::int64_t>(Load<std::uint64_t>(in_ + 32)) != JournalRecord::NoExpiry; }
+		// for the front ends that queue Commands (MatchingEngine, Exchange)
+		Command ToCommand() const
+		{
+			return Command{Command::Type::Add, GetOrderType(), GetOrderID(), GetSide(), GetPrice(), GetInitialQuantity(), GetExpiry(),
+						   GetDisplayQuantity(), GetStopPrice(), GetOwner()};
+		}
+
+	private:
+		const std::byte *in_;
+	};
+	class CancelMessage
+	{
+	public:
+		explicit CancelMessage(const std::byte *in) : in_{in} {}
+
+		OrderId GetOrderID() const { return Load<std::uint64_t>(in_ + 8); }
+		Command ToCommand() const { return Command::Cancel(GetOrderID()); }
+
+	private:
+		const std::byte *in_;
+	};
+	class ModifyMessage
+	{
+	public:
+		explicit ModifyMessage(const std::byte *in) : in_{in} {}
+
+		OrderId GetOrderID() const { return Load<std::uint64_t>(in_ + 8); }
+		Side GetSide() const { return static_cast<Side>(in_[2]); }
+		Price GetPrice() const { return static_cast<Price>(Load<std::uint32_t>(in_ + 4)); }
+		Quantity GetQuantity() const { return Load<std::uint32_t>(in_ + 16); }
+		Command ToCommand() const { return Command{Command::Type::Modify, OrderType::GoodTillCancel, GetOrderID(), GetSide(), GetPrice(), GetQuantity()}; }
+
+	private:
+		const std::byte *in_;
+	};
+
+	// fills packets for a sender, each command is encoded straight into the packet
+	class Writer
+	{
+	public:
+		explicit Writer(std::uint64_t sequence = 1);
+
+		bool Append(const Command &command); // false when it does not fit, send the packet, Clear and append again
+		std::span<const std::byte> Packet() const { return packet_; }
+		std::size_t Count() const { return count_; }
+		void Clear(); // the next packet starts where this one ended in sequence
+
+	private:
+		std::vector<std::byte> packet_;
+		std::uint64_t sequence_;
+		std::uint16_t count_{0};
+	};
+
+	// walks packets in sequence order and hands every valid message to a visitor, as an AddMessage, a CancelMessage or
+	// a ModifyMessage over the packet, in order; returns how many it handed out
+	// messages whose sequence numbers were read before are dropped, a packet past the next expected one is read all the
+	// same and the messages it skipped are counted as lost; a truncated packet is read up to the damage, and a message
+	// naming an order type or side that does not exist is dropped, both counted as malformed
+	class Reader
+	{
+	public:
+		template <typename Visitor>
+		std::size_t Read(std::span<const std::byte> packet, Visitor &&visitor);
+
+		std::uint64_t NextSequence() const { return nextSequence_; }
+		std::uint64_t Lost() const { return lost_; }
+		std::uint64_t Malformed() const { return malformed_; }
+
+	private:
+		std::uint64_t nextSequence_{1};
+		std::uint64_t lost_{0};
+		std::uint64_t malformed_{0};
+	};
+
+private:
+	template <typename T>
+	static T Load(const std::byte *in)
+	{
+		T value{};
+		if constexpr (std::endian::native == std::endian::little)
+		{
+			std::memcpy(&value, in, sizeof(T)); // one unaligned load
+		}
+		else
+		{
+			for (std::size_t i = 0; i < sizeof(T); ++i)
+			{
+				value |= static_cast<T>(std::to_integer<T>(in[i]) << (8 * i));
+			}
+		}
+		return value;
+	}
+	static bool IsSide(std::byte side) { return std::to_integer<unsigned>(side) <= static_cast<unsigned>(Side::Sell); }
+};
+
+template <typename Visitor>
+std::size_t OrderEntry::Reader::Read(std::span<const std::byte> packet, Visitor &&visitor)
+{
+	if (packet.size() < HeaderSize)
+	{
+		++malformed_;
+		return 0;
+	}
+	std::size_t visited = 0;
+	std::uint64_t sequence = Load<std::uint64_t>(packet.data());
+	const std::uint16_t count = Load<std::uint16_t>(packet.data() + 8);
+	std::size_t offset = HeaderSize;
+	for (std::uint16_t i = 0; i < count; ++i, ++sequence)
+	{
+		if (packet.size() - offset < LengthSize)
+		{
+			++malformed_;
+			break;
+		}
+		const std::size_t length = Load<std::uint16_t>(packet.data() + offset);
+		offset += LengthSize;
+		if (packet.size() - offset < length || length == 0)
+		{
+			++malformed_;
+			break;
+		}
+		const std::byte *in = packet.data() + offset;
+		offset += length;
+		if (sequence < nextSequence_) // sent twice, or replayed by a retransmission
+		{
+			continue;
+		}
+		lost_ += sequence - nextSequence_;
+		nextSequence_ = sequence + 1;
+
+		switch (static_cast<Message>(in[0]))
+		{
+		case Message::Add:
+			// checked before it is a view at all, the book must never see a type or a side that does not exist
+			if (length < AddSize || std::to_integer<std::size_t>(in[1]) >= OrderTypeCount || !IsSide(in[2]))
+			{
+				++malformed_;
+				break;
+			}
+			visitor(AddMessage{in});
+			++visited;
+			break;
+		case Message::Cancel:
+			if (length < CancelSize)
+			{
+				++malformed_;
+				break;
+			}
+			visitor(CancelMessage{in});
+			++visited;
+			break;
+		case Message::Modify:
+			if (length < ModifySize || !IsSide(in[2]))
+			{
+				++malformed_;
+				break;
+			}
+			visitor(ModifyMessage{in});
+			++visited;
+			break;
+		default: // a newer message this reader does not know, its sequence number still counts
+			break;
+		}
+	}
+	return visited;
+}
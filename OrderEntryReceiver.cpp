@@ -0,0 +1,75 @@
+#include "OrderEntryReceiver.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <unistd.h>
+
+OrderEntryReceiver::OrderEntryReceiver(std::uint16_t port, std::size_t batch)
+	: buffers_(std::max<std::size_t>(batch, 1) * OrderEntry::MaxPacketSize),
+	  vectors_(std::max<std::size_t>(batch, 1)),
+	  headers_(std::max<std::size_t>(batch, 1))
+{
+	packets_.reserve(headers_.size());
+	socket_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+	if (socket_ < 0)
+	{
+		throw std::runtime_error(std::format("Order entry socket cannot be opened: {}", std::strerror(errno)));
+	}
+	::setsockopt(socket_, SOL_SOCKET, SO_RCVBUF, &ReceiveBufferBytes, sizeof(ReceiveBufferBytes)); // capped by the kernel, a smaller one still works
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+	socklen_t length = sizeof(address);
+	if (::bind(socket_, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+		::getsockname(socket_, reinterpret_cast<sockaddr *>(&address), &length) != 0)
+	{
+		const int error = errno;
+		::close(socket_);
+		throw std::runtime_error(std::format("Order entry socket cannot be bound to port {}: {}", port, std::strerror(error)));
+	}
+	port_ = ntohs(address.sin_port);
+	for (std::size_t i = 0; i < headers_.size(); ++i)
+	{
+		vectors_[i] = iovec{buffers_.data() + i * OrderEntry::MaxPacketSize, OrderEntry::MaxPacketSize};
+		headers_[i].msg_hdr = msghdr{};
+		headers_[i].msg_hdr.msg_iov = &vectors_[i];
+		headers_[i].msg_hdr.msg_iovlen = 1;
+	}
+}
+OrderEntryReceiver::~OrderEntryReceiver()
+{
+	::close(socket_);
+}
+
+std::span<const std::span<const std::byte>> OrderEntryReceiver::Receive(std::chrono::milliseconds timeout)
+{
+	packets_.clear();
+	// recvmmsg's own timeout is only checked between datagrams, so the wait for the first one is a poll
+	pollfd ready{socket_, POLLIN, 0};
+	const int polled = ::poll(&ready, 1, static_cast<int>(timeout.count()));
+	if (polled == 0 || (polled < 0 && errno == EINTR))
+	{
+		return packets_;
+	}
+	const int received = polled < 0 ? -1 : ::recvmmsg(socket_, headers_.data(), static_cast<unsigned>(headers_.size()), MSG_DONTWAIT, nullptr);
+	if (received < 0)
+	{
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+		{
+			return packets_;
+		}
+		throw std::runtime_error(std::format("Order entry socket cannot be read: {}", std::strerror(errno)));
+	}
+	for (int i = 0; i < received; ++i)
+	{
+		packets_.emplace_back(buffers_.data() + i * OrderEntry::MaxPacketSize, headers_[i].msg_len);
+	}
+	return packets_;
+}
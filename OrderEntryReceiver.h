@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "OrderEntry.h"
+
+// order-entry packets off a UDP socket, for replaying recorded flow into a book
+// one recvmmsg call takes up to batch datagrams, each received into its own slot of one preallocated buffer; the packets
+// come back as they lie there, one batch for Orderbook::ApplyPackets, so a burst costs one system call and one lock
+// acquisition and its orders go to the book without leaving the buffer; the caller's reader counts loss and damage
+class OrderEntryReceiver
+{
+public:
+	// bound to port on every local address, 0 for any free port; throws when the socket cannot be set up
+	explicit OrderEntryReceiver(std::uint16_t port, std::size_t batch = 64);
+	OrderEntryReceiver(const OrderEntryReceiver &) = delete;
+	void operator=(const OrderEntryReceiver &) = delete;
+	~OrderEntryReceiver();
+
+	// waits up to timeout for a datagram, then takes every one already queued, up to batch
+	// the packets stay valid until the next call, none when nothing arrived in time; throws when the socket fails
+	// a datagram larger than a slot arrives cut short (MSG_TRUNC), the reader stops at the cut
+	std::span<const std::span<const std::byte>> Receive(std::chrono::milliseconds timeout);
+
+	std::uint16_t Port() const { return port_; }
+
+private:
+	static constexpr int ReceiveBufferBytes = 1 << 22; // asked of the kernel, so a burst waits in the socket rather than dropping
+
+	int socket_{-1};
+	std::uint16_t port_{};
+	std::vector<std::byte> buffers_; // batch slots of OrderEntry::MaxPacketSize
+	std::vector<iovec> vectors_;
+	std::vector<mmsghdr> headers_;
+	std::vector<std::span<const std::byte>> packets_; // the received part of each slot, reserved for a whole batch
+};
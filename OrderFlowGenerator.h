@@ -0,0 +1,286 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "Command.h"
+#include "Order.h"
+#include "OrderModify.h"
+#include "OrderType.h"
+#include "Side.h"
+#include "Usings.h"
+
+// synthetic order flow for the benchmarks and the replay tool, the same seed always yields the same commands
+// prices are (mid - depth, mid + depth), passive orders never cross so the resting book keeps its shape,
+// the generator remembers the passive orders it added so cancels and modifies always name a live order
+// mt19937_64 is fully specified by the standard and the draws below avoid the library's distributions,
+// so a seed produces the same flow with any compiler and standard library
+class OrderFlowGenerator
+{
+public:
+	explicit OrderFlowGenerator(std::uint64_t seed, Price mid = 10'000, Price depth = 1'000)
+		: random_{seed}, mid_{mid}, depth_{depth} {}
+
+	Price Mid() const { return mid_; }
+	Price Depth() const { return depth_; }
+
+	// count passive orders spread over both sides, the resting book the other workloads run against
+	Commands Prefill(std::size_t count)
+	{
+		Commands commands;
+		commands.reserve(count);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			commands.push_back(PassiveAdd(RandomSide()));
+		}
+		return commands;
+	}
+
+	// passive adds only, building a deep book level after level
+	Commands DeepBookAdds(std::size_t count) { return Prefill(count); }
+
+	// mostly cancels of resting orders, with enough adds to keep the book from draining
+	Commands CancelHeavy(std::size_t count)
+	{
+		Commands commands;
+		commands.reserve(count);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			if (live_.empty() || Uniform(0, 99) < 30)
+			{
+				commands.push_back(PassiveAdd(RandomSide()));
+			}
+			else
+			{
+				commands.push_back(Command::Cancel(TakeLive().orderId_));
+			}
+		}
+		return commands;
+	}
+
+	// buys that sweep through levels levels of the ask side, each preceded by the adds that refill them
+	// the sweep is a good till cancel order for exactly the refilled quantity, it fills completely and never rests
+	Commands Sweeps(std::size_t count, Price levels = 50)
+	{
+		Commands commands;
+		commands.reserve(count);
+		while (commands.size() < count)
+		{
+			Quantity swept = 0;
+			for (Price level = 1; level <= levels && commands.size() + 1 < count; ++level)
+			{
+				const Quantity quantity = RandomQuantity();
+				commands.push_back(Command::Add(Order{OrderType::GoodTillCancel, nextOrderId_++, Side::Sell, mid_ + level, quantity}));
+				swept += quantity;
+			}
+			commands.push_back(Command::Add(Order{OrderType::GoodTillCancel, nextOrderId_++, Side::Buy, mid_ + levels, swept}));
+		}
+		return commands;
+	}
+
+	// aggressive fill or kill and fill and kill orders against the resting book, mixed with passive adds near the touch
+	// that keep the first levels stocked, the quantities straddle what those levels hold, so a fill or kill
+	// takes both its accept and its reject path
+	Commands FillOrKillMix(std::size_t count)
+	{
+		Commands commands;
+		commands.reserve(count);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const auto roll = Uniform(0, 99);
+			const Side side = RandomSide();
+			if (roll < 40)
+			{
+				commands.push_back(PassiveAdd(side, 10));
+				continue;
+			}
+			// cross a few levels into the opposite side
+			const Price reach = static_cast<Price>(Uniform(1, 5));
+			const Price price = side == Side::Buy ? mid_ + reach : mid_ - reach;
+			const Quantity quantity = static_cast<Quantity>(Uniform(1, 400));
+			const OrderType type = roll < 70 ? OrderType::FillAndKill : OrderType::FillOrKill;
+			commands.push_back(Command::Add(Order{type, nextOrderId_++, side, price, quantity}));
+		}
+		return commands;
+	}
+
+	// fill or kill orders reaching through the whole opposite side for more than it holds, so each one is a scan of
+	// every level within reach and a reject, mixed with passive adds that keep both sides deep
+	Commands DeepFillOrKills(std::size_t count)
+	{
+		Commands commands;
+		commands.reserve(count);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const Side side = RandomSide();
+			if (Uniform(0, 99) < 20)
+			{
+				commands.push_back(PassiveAdd(side));
+				continue;
+			}
+			const Price price = side == Side::Buy ? mid_ + depth_ - 1 : mid_ - depth_ + 1;
+			commands.push_back(Command::Add(Order{OrderType::FillOrKill, nextOrderId_++, side, price, std::numeric_limits<Quantity>::max()}));
+		}
+		return commands;
+	}
+
+	// modifies of resting orders: half move the order to another passive price, half reduce it in place
+	Commands ModifyStorm(std::size_t count)
+	{
+		Commands commands;
+		commands.reserve(count);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			if (live_.empty())
+			{
+				commands.push_back(PassiveAdd(RandomSide()));
+				continue;
+			}
+			Resting &order = live_[Uniform(0, live_.size() - 1)];
+			if (order.quantity_ > 1 && Uniform(0, 1) == 0)
+			{
+				order.quantity_ = static_cast<Quantity>(Uniform(1, order.quantity_ - 1));
+			}
+			else
+			{
+				order.price_ = PassivePrice(order.side_);
+			}
+			commands.push_back(Command::Modify(OrderModify{order.orderId_, order.side_, order.price_, order.quantity_}));
+		}
+		return commands;
+	}
+
+	// Mixed's clock: command i of a stream comes at MixedTime(i), a century after the epoch so no real clock reaches it
+	// and the same seed gives the same commands on any day; a book expires them by calling ExpireOrders with these times
+	static ExpiryTime MixedTime(std::size_t command) { return ExpiryTime{std::chrono::hours{24 * 365 * 100} + std::chrono::seconds{command}}; }
+
+	// every command kind and order type in a narrow band around the mid, for checking books against each other rather
+	// than timing them: adds cross as often as they rest, stops sit where the trades reach them, and cancels and modifies
+	// name one of the last few adds, live or not, so they take both their applied and their rejected paths
+	// most adds carry one of a few owners, so self-trade prevention has something to prevent, and the good till date
+	// orders and half the stops expire within MixedExpiry commands of their arrival on Mixed's clock
+	Commands Mixed(std::size_t count, Price band = 8)
+	{
+		Commands commands;
+		commands.reserve(count);
+		std::vector<Resting> recent; // the last RecentAdds adds, whatever became of them
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const auto roll = Uniform(0, 99);
+			if (roll >= 80 && !recent.empty())
+			{
+				Resting &order = recent[Uniform(0, recent.size() - 1)];
+				if (roll < 88)
+				{
+					commands.push_back(Command::Cancel(order.orderId_));
+					continue;
+				}
+				// half shrink the order where it rests (in place if it is still there), half move it
+				if (order.quantity_ > 1 && Uniform(0, 1) == 0)
+				{
+					order.quantity_ = static_cast<Quantity>(Uniform(1, order.quantity_ - 1));
+				}
+				else
+				{
+					order.side_ = RandomSide();
+					order.price_ = BandPrice(band);
+					order.quantity_ = RandomQuantity();
+				}
+				commands.push_back(Command::Modify(OrderModify{order.orderId_, order.side_, order.price_, order.quantity_}));
+				continue;
+			}
+			const Resting order{nextOrderId_++, RandomSide(), BandPrice(band), RandomQuantity()};
+			if (recent.size() == RecentAdds)
+			{
+				recent[Uniform(0, RecentAdds - 1)] = order;
+			}
+			else
+			{
+				recent.push_back(order);
+			}
+			constexpr std::array<OrderType, 10> types{OrderType::GoodTillCancel, OrderType::GoodTillCancel, OrderType::GoodForDay,
+													 OrderType::GoodTillDate, OrderType::FillAndKill, OrderType::ImmediateOrCancel,
+													 OrderType::FillOrKill, OrderType::Market, OrderType::Iceberg, OrderType::Stop};
+			const ExpiryTime expiry = MixedTime(i + Uniform(1, MixedExpiry));
+			Command add;
+			switch (const OrderType type = types[Uniform(0, types.size() - 1)])
+			{
+			case OrderType::Market:
+				add = Command::Add(Order{order.orderId_, order.side_, order.quantity_});
+				break;
+			case OrderType::GoodTillDate:
+				add = Command::Add(Order{type, order.orderId_, order.side_, order.price_, order.quantity_, expiry});
+				break;
+			case OrderType::Iceberg:
+				add = Command::Add(Order{type, order.orderId_, order.side_, order.price_, order.quantity_, static_cast<Quantity>(Uniform(1, 20))});
+				break;
+			case OrderType::Stop: // half of them stop limits, and half of each expire
+				add = Command::Add(Uniform(0, 1) ? Order::Stop(order.orderId_, order.side_, BandPrice(band), order.quantity_)
+												 : Order::StopLimit(order.orderId_, order.side_, BandPrice(band), order.price_, order.quantity_));
+				if (Uniform(0, 1))
+				{
+					add.expiry_ = expiry;
+				}
+				break;
+			default:
+				add = Command::Add(Order{type, order.orderId_, order.side_, order.price_, order.quantity_});
+				break;
+			}
+			add.owner_ = static_cast<OwnerId>(Uniform(0, MixedOwners)); // 0 for none
+			commands.push_back(add);
+		}
+		return commands;
+	}
+
+private:
+	struct Resting
+	{
+		OrderId orderId_;
+		Side side_;
+		Price price_;
+		Quantity quantity_;
+	};
+	static constexpr std::size_t RecentAdds = 64; // the adds Mixed's cancels and modifies pick from
+	static constexpr std::size_t MixedOwners = 3;
+	static constexpr std::size_t MixedExpiry = 2'000; // the most commands an expiring order of Mixed outlives its arrival by
+
+	// a draw in [low, high], the modulo bias is irrelevant for these ranges
+	std::uint64_t Uniform(std::uint64_t low, std::uint64_t high) { return low + random_() % (high - low + 1); }
+	Side RandomSide() { return Uniform(0, 1) ? Side::Buy : Side::Sell; }
+	Quantity RandomQuantity() { return static_cast<Quantity>(Uniform(1, 100)); }
+	Price PassivePrice(Side side, Price maxOffset) // strictly behind the mid, so a passive order never matches
+	{
+		const Price offset = static_cast<Price>(Uniform(1, static_cast<std::uint64_t>(maxOffset)));
+		return side == Side::Buy ? mid_ - offset : mid_ + offset;
+	}
+
+	Price PassivePrice(Side side) { return PassivePrice(side, depth_); }
+	Price BandPrice(Price band) { return mid_ - band + static_cast<Price>(Uniform(0, 2 * static_cast<std::uint64_t>(band))); } // either side of the mid
+
+	Command PassiveAdd(Side side, Price maxOffset)
+	{
+		const Resting order{nextOrderId_++, side, PassivePrice(side, maxOffset), RandomQuantity()};
+		live_.push_back(order);
+		return Command::Add(Order{OrderType::GoodTillCancel, order.orderId_, order.side_, order.price_, order.quantity_});
+	}
+	Command PassiveAdd(Side side) { return PassiveAdd(side, depth_); }
+	Resting TakeLive() // remove a random live order, swapping the last one into its slot
+	{
+		const std::size_t index = Uniform(0, live_.size() - 1);
+		const Resting order = live_[index];
+		live_[index] = live_.back();
+		live_.pop_back();
+		return order;
+	}
+
+	std::mt19937_64 random_;
+	Price mid_;
+	Price depth_;
+	OrderId nextOrderId_{1};
+	std::vector<Resting> live_; // passive orders added so far and not cancelled
+};
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "RestingOrder.h"
+#include "Usings.h"
+
+// order id -> resting order, flat so a lookup is a probe or two within one array rather than a chase through nodes
+// hashed: open addressing with Robin Hood probing and backward-shift deletion (no tombstones), sized at
+// construction for the book's capacity and doubled only if the book outgrows it
+// an id's home slot is the id modulo a prime slot count: consecutive ids land in consecutive slots (one cache
+// line serves several), and ids on a stride such as per-gateway sequences still spread over every slot
+// direct (OrderbookConfig::directOrderIdWindow_): for exchanges handing out dense, increasing ids, an id picks
+// its slot in a window directly (id modulo the window); the rare id whose slot still holds an older live order
+// goes to the hashed table instead, so a long-lived order never blocks an add
+class OrderIndex
+{
+public:
+	OrderIndex(std::size_t capacity, std::size_t directWindow)
+	{
+		if (directWindow)
+		{
+			direct_.resize(std::bit_ceil(directWindow));
+			directMask_ = direct_.size() - 1;
+			Rehash(MinSlots); // only the collisions land here
+		}
+		else
+		{
+			Rehash(std::max(capacity * 2, MinSlots)); // at most half full within capacity
+		}
+	}
+
+	RestingOrder *Find(OrderId orderId) const // null when the id is not in the book
+	{
+		if (!direct_.empty())
+		{
+			const Slot &slot = direct_[orderId & directMask_];
+			if (slot.order_ && slot.orderId_ == orderId)
+			{
+				return slot.order_;
+			}
+			if (!hashedSize_)
+			{
+				return nullptr;
+			}
+		}
+		for (std::size_t index = Home(orderId), distance = 0;; index = Next(index), ++distance)
+		{
+			const Slot &slot = slots_[index];
+			if (!slot.order_ || Distance(slot, index) < distance) // the id would have displaced this slot, it is not here
+			{
+				return nullptr;
+			}
+			if (slot.orderId_ == orderId)
+			{
+				return slot.order_;
+			}
+		}
+	}
+	bool Contains(OrderId orderId) const { return Find(orderId) != nullptr; }
+
+	void Insert(RestingOrder *order) // the order's id must not be in the index yet
+	{
+		const Slot entry{order->GetOrderID(), order};
+		++size_;
+		if (!direct_.empty())
+		{
+			Slot &slot = direct_[entry.orderId_ & directMask_];
+			if (!slot.order_)
+			{
+				slot = entry;
+				return;
+			}
+		}
+		if ((hashedSize_ + 1) * 4 > slots_.size() * 3) // keep the probes short
+		{
+			Rehash(slots_.size() * 2);
+		}
+		Place(entry);
+		++hashedSize_;
+	}
+	void Erase(OrderId orderId) // nothing happens if the id is not in the index
+	{
+		if (!direct_.empty())
+		{
+			Slot &slot = direct_[orderId & directMask_];
+			if (slot.order_ && slot.orderId_ == orderId)
+			{
+				slot = Slot{};
+				--size_;
+				return;
+			}
+		}
+		std::size_t index = Home(orderId);
+		for (std::size_t distance = 0;; index = Next(index), ++distance)
+		{
+			const Slot &slot = slots_[index];
+			if (!slot.order_ || Distance(slot, index) < distance)
+			{
+				return;
+			}
+			if (slot.orderId_ == orderId)
+			{
+				break;
+			}
+		}
+		// pull the rest of the cluster back by one, so no lookup ever has to step over a hole
+		for (std::size_t next = Next(index); slots_[next].order_ && Distance(slots_[next], next) != 0; next = Next(next))
+		{
+			slots_[index] = slots_[next];
+			index = next;
+		}
+		slots_[index] = Slot{};
+		--hashedSize_;
+		--size_;
+	}
+
+	std::size_t Size() const { return size_; }
+
+private:
+	struct Slot
+	{
+		OrderId orderId_{};
+		RestingOrder *order_{nullptr}; // null for an empty slot
+	};
+	static constexpr std::size_t MinSlots = 16;
+
+	std::size_t Home(OrderId orderId) const { return static_cast<std::size_t>(orderId % slots_.size()); }
+	std::size_t Next(std::size_t index) const { return index + 1 == slots_.size() ? 0 : index + 1; }
+	std::size_t Distance(const Slot &slot, std::size_t index) const // how far past its home slot an entry sits
+	{
+		const std::size_t home = Home(slot.orderId_);
+		return index >= home ? index - home : index + slots_.size() - home;
+	}
+	static std::size_t NextPrime(std::size_t number) // only when the table is sized, trial division is plenty
+	{
+		for (;; ++number)
+		{
+			bool prime = number >= 2;
+			for (std::size_t divisor = 2; prime && divisor * divisor <= number; ++divisor)
+			{
+				prime = number % divisor != 0;
+			}
+			if (prime)
+			{
+				return number;
+			}
+		}
+	}
+
+	void Place(Slot entry) // Robin Hood: an entry far from home takes the slot of one nearer to its own
+	{
+		std::size_t index = Home(entry.orderId_);
+		for (std::size_t distance = 0; slots_[index].order_; index = Next(index), ++distance)
+		{
+			const std::size_t existing = Distance(slots_[index], index);
+			if (existing < distance)
+			{
+				std::swap(entry, slots_[index]);
+				distance = existing;
+			}
+		}
+		slots_[index] = entry;
+	}
+	void Rehash(std::size_t slotCount) // to the first prime at or above slotCount
+	{
+		std::vector<Slot> old = std::move(slots_);
+		slots_.assign(NextPrime(slotCount), Slot{});
+		for (const Slot &slot : old)
+		{
+			if (slot.order_)
+			{
+				Place(slot);
+			}
+		}
+	}
+
+	std::vector<Slot> slots_;
+	std::size_t hashedSize_{0}; // entries in slots_
+	std::vector<Slot> direct_;	// empty unless direct mode
+	std::size_t directMask_{0};
+	std::size_t size_{0};
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+
+#include "RestingOrder.h"
+
+// intrusive FIFO of the orders resting at one price level
+// the links live inside RestingOrder, so pushing or erasing never allocates and an order handle
+// (a raw RestingOrder*) stays valid until the order leaves the book
+class OrderList
+{
+public:
+	class Iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = RestingOrder;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const RestingOrder *;
+		using reference = const RestingOrder &;
+
+		Iterator() = default;
+		explicit Iterator(const RestingOrder *order) : order_{order} {}
+		reference operator*() const { return *order_; }
+		pointer operator->() const { return order_; }
+		Iterator &operator++()
+		{
+			order_ = order_->next_;
+			return *this;
+		}
+		Iterator operator++(int)
+		{
+			Iterator previous = *this;
+			++*this;
+			return previous;
+		}
+		bool operator==(const Iterator &other) const { return order_ == other.order_; }
+
+	private:
+		const RestingOrder *order_{nullptr};
+	};
+
+	bool empty() const { return head_ == nullptr; }
+	std::size_t size() const { return size_; }
+	RestingOrder *front() const { return head_; }
+	RestingOrder *back() const { return tail_; }
+	Iterator begin() const { return Iterator{head_}; }
+	Iterator end() const { return Iterator{}; }
+
+	void push_back(RestingOrder *order) // join the back of the queue (time priority)
+	{
+		order->prev_ = tail_;
+		order->next_ = nullptr;
+		if (tail_)
+		{
+			tail_->next_ = order;
+		}
+		else
+		{
+			head_ = order;
+		}
+		tail_ = order;
+		++size_;
+	}
+	void erase(RestingOrder *order) // unlink from anywhere in the queue in O(1)
+	{
+		if (order->prev_)
+		{
+			order->prev_->next_ = order->next_;
+		}
+		else
+		{
+			head_ = order->next_;
+		}
+		if (order->next_)
+		{
+			order->next_->prev_ = order->prev_;
+		}
+		else
+		{
+			tail_ = order->prev_;
+		}
+		order->prev_ = order->next_ = nullptr;
+		--size_;
+	}
+	void pop_front() { erase(head_); }
+	// unlink, front to back, at most maxOrders of the orders pred(order) holds for, handing each to release once
+	// it is unlinked (release may reuse its links); returns how many it unlinked
+	template <typename Pred, typename Fn>
+	std::size_t erase_if(Pred &&pred, Fn &&release, std::size_t maxOrders)
+	{
+		std::size_t erased = 0;
+		for (RestingOrder *order = head_; order && erased < maxOrders;)
+		{
+			RestingOrder *next = order->next_;
+			if (pred(*order))
+			{
+				erase(order);
+				release(order);
+				++erased;
+			}
+			order = next;
+		}
+		return erased;
+	}
+
+private:
+	RestingOrder *head_{nullptr};
+	RestingOrder *tail_{nullptr};
+	std::size_t size_{0};
+};
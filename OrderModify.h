@@ -10,6 +10,10 @@ public:
     Side GetSide() const { return side_; }
     Price GetPrice() const { return price_; }
     Quantity GetQuantity() const { return quantity_; }
+    Order ToOrder(OrderType type, ExpiryTime expiry = ExpiryTime::max()) const
+    {
+        return Order{type, GetOrderID(), GetSide(), GetPrice(), GetQuantity(), expiry};
+    }
     OrderPointer ToOrderPointer(OrderType type) const
     {
         return std::make_shared<Order>(type, GetOrderID(), GetSide(), GetPrice(),
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Order.h"
+#include "OrderDetails.h"
+#include "RestingOrder.h"
+
+// free-list arena of resting orders, split hot and cold
+// every slab is a block of RestingOrders and a block of their OrderDetails side by side, slot n of one belongs to
+// slot n of the other; the levels only ever link the compact RestingOrders, the details are looked up by slot
+// the first slab is sized at construction (rounded up to a power of two, so a slot splits into slab and index
+// with a shift and a mask), released orders are recycled, so a book that stays within its capacity never touches
+// the heap when orders are added or cancelled; running out of slots grows the pool by another slab instead of failing
+class OrderPool
+{
+public:
+	explicit OrderPool(std::size_t capacity) : slabShift_{std::countr_zero(std::bit_ceil(std::max<std::size_t>(capacity, 1)))} { Grow(); }
+	OrderPool(const OrderPool &) = delete;
+	OrderPool &operator=(const OrderPool &) = delete;
+	~OrderPool() = default; // both halves are trivially destructible, slabs are freed wholesale
+
+	template <typename O>
+	RestingOrder *Acquire(const O &order, Quantity remaining) // the order as it rests, partly filled to remaining, from anything with Order's getters
+	{
+		return Acquire(order, order.GetInitialQuantity(), remaining);
+	}
+	template <typename O>
+	RestingOrder *Acquire(const O &order, Quantity initial, Quantity remaining) // the same, with initial in place of the order's own
+	{
+		if (!free_)
+		{
+			Grow();
+		}
+		RestingOrder *resting = free_;
+		free_ = resting->next_;
+		++used_;
+		resting->prev_ = resting->next_ = nullptr;
+		resting->orderId_ = order.GetOrderID();
+		const Quantity peak = order.GetOrderType() == OrderType::Iceberg ? order.GetDisplayQuantity() : Quantity{};
+		const Quantity slice = SplitIceberg(initial, remaining, peak);
+		resting->remainingQuantity_ = slice;
+		Details(resting) = OrderDetails{order.GetPrice(), initial, order.GetSide(), order.GetOrderType(), order.GetExpiry(),
+										peak, remaining - slice, order.GetStopPrice(), order.GetOwner(), nullptr, nullptr};
+		return resting;
+	}
+	// the slice of remaining an iceberg of this peak shows (see OrderDetails), all of it without a peak
+	static Quantity SplitIceberg(Quantity initial, Quantity remaining, Quantity peak)
+	{
+		return peak ? std::min(remaining, peak - (initial - remaining) % peak) : remaining;
+	}
+	void Release(RestingOrder *order)
+	{
+		order->next_ = free_;
+		free_ = order;
+		--used_;
+	}
+
+	OrderDetails &Details(const RestingOrder *order) { return details_[order->slot_ >> slabShift_][order->slot_ & SlabMask()]; }
+	const OrderDetails &Details(const RestingOrder *order) const { return details_[order->slot_ >> slabShift_][order->slot_ & SlabMask()]; }
+	Order ToOrder(const RestingOrder *order) const // both halves put back together, partly filled to what remains
+	{
+		const OrderDetails &details = Details(order);
+		Order value{details.orderType_, order->orderId_, details.side_, details.price_, details.initialQuantity_, details.expiry_, details.peak_, details.stopPrice_, details.owner_};
+		value.Fill(details.initialQuantity_ - Remaining(order));
+		return value;
+	}
+	Quantity Remaining(const RestingOrder *order) const { return order->remainingQuantity_ + Details(order).reserve_; } // the slice and the reserve
+
+	std::size_t Size() const { return used_; }
+	std::size_t Capacity() const { return orders_.size() << slabShift_; }
+
+private:
+	std::size_t SlabMask() const { return (std::size_t{1} << slabShift_) - 1; }
+
+	void Grow()
+	{
+		const std::size_t slabSize = std::size_t{1} << slabShift_;
+		const std::size_t first = Capacity(); // the slot of the new slab's first order
+		auto &slab = orders_.emplace_back(std::make_unique<RestingOrder[]>(slabSize));
+		details_.emplace_back(std::make_unique<OrderDetails[]>(slabSize));
+		for (std::size_t i = slabSize; i-- > 0;) // thread the new slots in address order
+		{
+			slab[i].slot_ = static_cast<std::uint32_t>(first + i);
+			slab[i].next_ = free_;
+			free_ = &slab[i];
+		}
+	}
+
+	int slabShift_;
+	std::vector<std::unique_ptr<RestingOrder[]>> orders_;
+	std::vector<std::unique_ptr<OrderDetails[]>> details_;
+	RestingOrder *free_{nullptr};
+	std::size_t used_{0};
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+
 enum class OrderType
 {
     GoodTillCancel,
@@ -8,4 +10,12 @@ enum class OrderType
     ImmediateOrCancel,
     GoodForDay,
     Market,
-};
\ No newline at end of file
+    GoodTillDate, // rests until its own expiry time
+    Iceberg,      // rests until cancelled, showing only a slice of its quantity at a time (Order::GetDisplayQuantity)
+    Stop,         // waits off the book until a trade prints at its stop price (Order::GetStopPrice), then trades as a market order
+    StopLimit,    // the same, then rests or trades as a good till cancel order at its price
+};
+
+inline constexpr std::size_t OrderTypeCount = static_cast<std::size_t>(OrderType::StopLimit) + 1; // StopLimit stays the last type
+
+inline constexpr bool IsStop(OrderType type) { return type == OrderType::Stop || type == OrderType::StopLimit; }
@@ -1,357 +1,352 @@
 #include "Orderbook.h"
 
+#include <algorithm>
 #include <chrono>
-#include <ctime>
-#include <numeric>
 
-void Orderbook::PruneGoodForDayOrders()
+#include "ThreadAffinity.h"
+
+void Orderbook::PruneExpiredOrders()
 {
-	using namespace std::chrono;
-	const auto end = hours(16); // close of the market
-	while (true)
+	// condition_variable wait: an atomic operation that unlocks the mutex and sleeps until notified or timed out
+	// logic: we lock the mutex, then check what to do, and unlock+sleep until there is something to do
+	// - nothing in the book expires: sleep until an add brings an expiring order (or shutdown) notifies us
+	// - the earliest expiry lies ahead: sleep until then, an add with an earlier expiry notifies us to re-check
+	// - the earliest expiry has passed: cancel the due orders one chunk at a time, releasing the lock between
+	//   chunks so matching threads are not starved while a large close is being expired
+	// the expiry index hands us only the due orders, we never walk the whole book
+	// tombstones of lazy cancels past CompactThreshold are released the same way, a chunk per lock acquisition
+	std::unique_lock<std::mutex> ordersLock = LockBook();
+	while (!shutdown_.load(std::memory_order_acquire))
 	{
-		const auto now = system_clock::now();			 // current time
-		const auto now_c = system_clock::to_time_t(now); // current time in seconds
-		std::tm now_parts;								 // current time in parts
-		localtime_r(&now_c, &now_parts);				 // convert current time to parts
-		if (now_parts.tm_hour >= end.count())
+		if (core_.TombstoneCount() >= CompactThreshold)
 		{
-			now_parts.tm_mday += 1; // if the current time is after the close of the market, we need to increment the day (waiting for the next day)
+			core_.CompactLevels(CompactChunk); // the book looks the same after, nothing to publish
+			ordersLock.unlock();
+			std::this_thread::yield();
+			ordersLock.lock();
+			continue;
 		}
-
-		now_parts.tm_hour = end.count(); // set the hour to 4 pm
-		now_parts.tm_min = 0;			 // exact time of 4 pm
-		now_parts.tm_sec = 0;
-		auto next = system_clock::from_time_t(mktime(&now_parts)); // the time we want to wait for (today at 4 pm, or tomorrow at 4 pm if the current time is after the close of the market)
-		auto till = next - now + milliseconds(100);
-
+		const auto next = core_.NextExpiry();
+		if (!next)
 		{
-			// unique_lock and wait_for: an atomic operation that waits for the condition variable to be notified
-			// logic: we lock the mutex, then unlock+sleep, waiting for the condition variable to be notified
-			// if shutdown is true, we return (cond1)
-			// if the condition variable is notified (whether by shutdown(i.e. notify_one) or the condition variable (till)), we wake up and see if we are timed out (till is reached) or not (early return) (cond2)
-			// once we wake up, we lock the mutex again and check the condition again
-			// if it is timed out, we continue to cancel the good for day orders (out of the lock scope, so it is unlocked)
-			// the lock is for wait, not for protecting the data structure (orders_, bids_, asks_)
-			std::unique_lock<std::mutex> orderslock{ordersMutex_};
-
-			if (shutdown_.load(std::memory_order_acquire) ||										 // orderbook is shut down
-				shutdownConditionVariable_.wait_for(orderslock, till) == std::cv_status::no_timeout) // wait for 4pm or the condition variable to be notified (if no_timeout, it means we received a wake up signal to before 4pm)
-			{
-				return;
-			}
+			shutdownConditionVariable_.wait(ordersLock);
+			continue;
 		}
-
-		OrderIds orderIds;
+		const auto now = std::chrono::system_clock::now();
+		if (now < *next)
 		{
-			// we block all the threads from adding or modifying the orderbook data structure while we are canceling the good for day orders
-			// every thread with the same mutex (ordersMutex_) is blocked so we can iterate over the orders_ map without worrying about data race
-			std::scoped_lock ordersLock{ordersMutex_};
-			for (const auto &[_, entry] : orders_)
-			{
-				const auto &[order, __] = entry;
-				if (order->GetOrderType() != OrderType::GoodForDay)
-				{
-					continue;
-				}
-				orderIds.push_back(order->GetOrderID());
-			}
+			shutdownConditionVariable_.wait_until(ordersLock, *next);
+			continue;
+		}
+		const std::size_t expired = core_.ExpireOrders(now, PruneChunk);
+		ORDERBOOK_STATS_ONLY(++pruneSweeps_;)
+		PublishSnapshot();
+		if (expired == PruneChunk) // more may be due, let the other threads in first
+		{
+			ordersLock.unlock();
+			std::this_thread::yield();
+			ordersLock.lock();
 		}
-		CancelOrders(orderIds);
 	}
 }
-void Orderbook::CancelOrders(OrderIds orderIds) // cancel multiple orders
+
+bool Orderbook::RunHousekeeping()
 {
-	// we lock the mutex at once, this is more efficient than locking it for each order (i.e. calling CancelOrderInternal for each order)
-	std::scoped_lock ordersLock{ordersMutex_};
-	for (const auto &orderId : orderIds)
+	const auto ordersLock = LockBook();
+	bool more = false;
+	if (core_.TombstoneCount() >= CompactThreshold)
 	{
-		CancelOrderInternal(orderId);
+		core_.CompactLevels(CompactChunk);
+		more = core_.TombstoneCount() >= CompactThreshold;
 	}
+	const auto next = core_.NextExpiry();
+	if (next)
+	{
+		const auto now = std::chrono::system_clock::now();
+		if (*next <= now)
+		{
+			more |= core_.ExpireOrders(now, PruneChunk) == PruneChunk;
+			ORDERBOOK_STATS_ONLY(++pruneSweeps_;)
+			PublishSnapshot();
+		}
+	}
+	return more;
 }
-void Orderbook::CancelOrderInternal(OrderId orderId) // helper function to cancel an order
+
+Orderbook::Orderbook(const OrderbookConfig &config, const ScopedPin &)
+	: core_{config},
+	  publishSnapshot_{config.publishSnapshot_},
+	  preTrade_{config.preTrade_ ? std::optional<PreTradeCheck>{std::in_place, *config.preTrade_, config.ladder_} : std::nullopt} {}
+Orderbook::Orderbook(OrderbookConfig config, ThreadPlacement placement)
+	: Orderbook{config, ScopedPin{placement.localMemory_ ? placement.matchingCore_ : std::nullopt}}
 {
-	if (!orders_.contains(orderId)) // order does not exist
+	// started once the pin is gone, a new thread would inherit the matching core from this one
+	if (placement.inlineHousekeeping_)
 	{
 		return;
 	}
-	const auto &[order, iterator] = orders_.at(orderId);
-	orders_.erase(orderId);
-	if (order->GetSide() == Side::Sell) // cancel from asks
+	ordersPruneThread_ = std::thread{[this]
+									 { PruneExpiredOrders(); }};
+	if (placement.housekeepingCore_)
 	{
-		auto price = order->GetPrice();
-		auto &orders = asks_.at(price);
-		orders.erase(iterator);
-		if (orders.empty()) // no more orders at this price level
-		{
-			asks_.erase(price);
-		}
+		PinThread(ordersPruneThread_, *placement.housekeepingCore_);
 	}
-	else // cancel from bids
-	{
-		auto price = order->GetPrice();
-		auto &orders = bids_.at(price);
-		orders.erase(iterator);
-		if (orders.empty()) // no more orders at this price level
-		{
-			bids_.erase(price);
-		}
-	}
-	OnOrderCancelled(order);
 }
-void Orderbook::OnOrderCancelled(OrderPointer order)
+Orderbook::~Orderbook()
 {
-	UpdateLevelData(order->GetPrice(), order->GetRemainingQuantity(), LevelData::Action::Remove);
+	{
+		// set the flag under the lock, otherwise the notify can land between the prune thread's check and its wait and be lost
+		std::scoped_lock ordersLock{ordersMutex_};
+		shutdown_.store(true, std::memory_order_release);
+	}
+	shutdownConditionVariable_.notify_one(); // notify the prune thread to wake up
+	if (ordersPruneThread_.joinable())
+	{
+		ordersPruneThread_.join(); // wait for the prune thread to finish
+	}
 }
 
-void Orderbook::OnOrderAdded(OrderPointer order)
-{
-	UpdateLevelData(order->GetPrice(), order->GetInitialQuantity(), LevelData::Action::Add);
-}
-void Orderbook::OnOrderMatched(Price price, Quantity quantity, bool isFullyFilled)
+void Orderbook::AddOrder(const Order &order, Trades &trades)
 {
-	UpdateLevelData(price, quantity, isFullyFilled ? LevelData::Action::Remove : LevelData::Action::Match);
-}
-void Orderbook::UpdateLevelData(Price price, Quantity quantity, LevelData::Action action)
-{
-	auto &data = data_[price];
-	data.count_ += action == LevelData::Action::Remove ? -1 : action == LevelData::Action::Add ? 1
-																							   : 0;
-	if (action == LevelData::Action::Remove || action == LevelData::Action::Match)
+	if (!PassesPreTrade(order)) // rejected like any add the book refuses, without ever waiting for the lock
 	{
-		data.quantity_ -= quantity;
+		return;
 	}
-	else
+	const auto ordersLock = LockBook();
+	const auto nextExpiry = core_.NextExpiry();
+	core_.AddOrder(order, trades);
+	NotifyIfExpiryMoved(nextExpiry);
+	PublishSnapshot();
+}
+void Orderbook::ModifyOrder(OrderModify order, Trades &trades)
+{
+	// the cancel and the re-add happen under one lock, no other thread can slip in between them
+	// the limits are checked on the re-add's shape first, a modify that breaches them leaves the resting order alone
+	if (preTrade_ && preTrade_->Validate(Command::Modify(order)) != PreTradeCheck::Result::Passed)
 	{
-		data.quantity_ += quantity;
+		ORDERBOOK_STATS_ONLY(preTradeRejects_.fetch_add(1, std::memory_order_relaxed);)
+		return;
 	}
-	if (data.count_ == 0)
-		data_.erase(price);
+	const auto ordersLock = LockBook();
+	const auto nextExpiry = core_.NextExpiry();
+	const std::size_t tombstones = core_.TombstoneCount();
+	core_.ModifyOrder(order, trades);
+	NotifyIfExpiryMoved(nextExpiry);
+	NotifyIfCompactionDue(tombstones);
+	PublishSnapshot();
 }
-bool Orderbook::CanFullyFill(Side side, Price price, Quantity quantity) const
+std::unique_lock<std::mutex> Orderbook::LockBook() const
 {
-	if (!CanMatch(side, price))
+#if defined(ORDERBOOK_STATS)
+	// only a contended lock reads the clock, the wait is recorded once the lock is ours
+	std::unique_lock<std::mutex> ordersLock{ordersMutex_, std::try_to_lock};
+	std::uint64_t waited = 0;
+	if (!ordersLock.owns_lock())
 	{
-		return false;
+		const std::uint64_t start = ReadTicks();
+		ordersLock.lock();
+		waited = ReadTicks() - start;
 	}
-	// at least one order can be matched
-	std::optional<Price> threshold;
-	if (side == Side::Buy)
+	lockWait_.Record(waited);
+	return ordersLock;
+#else
+	return std::unique_lock<std::mutex>{ordersMutex_};
+#endif
+}
+void Orderbook::NotifyIfExpiryMoved(std::optional<ExpiryTime> previous)
+{
+	const auto next = core_.NextExpiry();
+	if (next && (!previous || *next < *previous)) // the prune thread sleeps towards a later deadline, or not at all
 	{
-		const auto [askPrice, _] = *asks_.begin();
-		threshold = askPrice;
+		shutdownConditionVariable_.notify_one();
 	}
-	else
+}
+bool Orderbook::PassesPreTrade(const Order &order) const
+{
+	if (!preTrade_)
 	{
-		const auto [bidPrice, _] = *bids_.begin();
-		threshold = bidPrice;
+		return true;
 	}
-	// go through the price levels from best(threshold) to worst(your price)
-	// in buy side, we want to go from best ask to your bidding price
-	// in sell side, we want to go from best bid to your asking price
-	for (const auto &[levelPrice, levelData] : data_)
+	PreTradeCheck::Result result = preTrade_->Validate(order);
+	// only an immediate order reads the snapshot, for the rest it would be a wasted copy
+	const bool immediate = order.GetOrderType() == OrderType::FillAndKill || order.GetOrderType() == OrderType::FillOrKill ||
+						   order.GetOrderType() == OrderType::ImmediateOrCancel || order.GetOrderType() == OrderType::Market;
+	if (result == PreTradeCheck::Result::Passed && publishSnapshot_ && immediate)
 	{
-		// skip the price levels that are better than the threshold
-		if (threshold.has_value())
+		// published under ordersMutex_ before every call that changed the book returned, so the snapshot holds at least
+		// every change this thread has seen; a change it misses is one this order may as well have arrived before
+		const BookSnapshot snapshot = snapshot_.Load();
+		if (snapshot.version_)
 		{
-			if ((side == Side::Buy && threshold.value() > levelPrice) ||
-				(side == Side::Sell && threshold.value() < levelPrice))
-			{
-				continue;
-			}
-		}
-		// skip the price levels that are worse than your price
-		if ((side == Side::Buy && levelPrice > price) ||
-			(side == Side::Sell && levelPrice < price))
-		{
-			continue;
+			result = PreTradeCheck::Screen(order, snapshot);
 		}
-		if (quantity <= levelData.quantity_)
-		{
-			return true;
-		}
-		quantity -= levelData.quantity_;
 	}
-	return false;
+	ORDERBOOK_STATS_ONLY(if (result != PreTradeCheck::Result::Passed) { preTradeRejects_.fetch_add(1, std::memory_order_relaxed); })
+	return result == PreTradeCheck::Result::Passed;
 }
-bool Orderbook::CanMatch(Side side, Price price) const // check if the order can be matched (for FillAndKill and ImmediateOrCancel orders)
+void Orderbook::NotifyIfCompactionDue(std::size_t previous)
 {
-	if (side == Side::Buy)
+	if (previous < CompactThreshold && core_.TombstoneCount() >= CompactThreshold) // only on the way up, once per pile
 	{
-		if (asks_.empty())
-		{
-			return false;
-		}
-		const auto &[bestAsk, _] = *asks_.begin(); // get the best ask price
-		return price >= bestAsk;
+		shutdownConditionVariable_.notify_one();
 	}
-	else
+}
+void Orderbook::PublishSnapshot()
+{
+	if (!publishSnapshot_)
 	{
-		if (bids_.empty())
-		{
-			return false;
-		}
-		const auto &[bestBid, _] = *bids_.begin(); // get the best bid price
-		return price <= bestBid;
+		return;
 	}
+	BookSnapshot snapshot = core_.GetSnapshot();
+	snapshot.version_ = ++snapshotVersion_;
+	snapshot_.Store(snapshot);
 }
-Trades Orderbook::MatchOrders()
+Trades Orderbook::AddOrder(const Order &order)
 {
 	Trades trades;
-	trades.reserve(orders_.size());
-	while (true) // keep matching orders until no more orders can be matched
-	{
-		if (bids_.empty() || asks_.empty()) // no more orders to match
-		{
-			break;
-		}
-		auto &[bidPrice, bids] = *bids_.begin();
-		auto &[askPrice, asks] = *asks_.begin();
-		if (bidPrice < askPrice) // no more valid orders to match
-		{
-			break;
-		}
-		while (bids.size() && asks.size())
-		{
-			auto &bid = bids.front();
-			auto &ask = asks.front();
-			Quantity quantity = std::min(bid->GetRemainingQuantity(),
-										 ask->GetRemainingQuantity());
-			bid->Fill(quantity);
-			ask->Fill(quantity);
-
-			if (bid->IsFilled())
-			{
-				bids.pop_front();
-				orders_.erase(bid->GetOrderID());
-			}
-			if (ask->IsFilled())
-			{
-				asks.pop_front();
-				orders_.erase(ask->GetOrderID());
-			}
-			if (bids.empty()) // no more bid orders at this price level
-			{
-				bids_.erase(bidPrice);
-				data_.erase(bidPrice);
-			}
-			if (asks.empty()) // no more ask orders at this price level
-			{
-				asks_.erase(askPrice);
-				data_.erase(askPrice);
-			}
-			trades.push_back(
-				Trade{TradeInfo{bid->GetOrderID(), bid->GetPrice(), quantity},
-					  TradeInfo{ask->GetOrderID(), ask->GetPrice(), quantity}});
-			OnOrderMatched(bid->GetPrice(), quantity, bid->IsFilled());
-			OnOrderMatched(ask->GetPrice(), quantity, ask->IsFilled());
-		}
-		if (!bids_.empty()) // check if there are any FillAndKill orders at this price level
-		{
-			auto &[_, bids] = *bids_.begin();
-			auto &order = bids.front();
-			if (order->GetOrderType() == OrderType::FillAndKill)
-			{
-				CancelOrder(order->GetOrderID());
-			}
-		}
-		if (!asks_.empty())
-		{
-			auto &[_, asks] = *asks_.begin();
-			auto &order = asks.front();
-			if (order->GetOrderType() == OrderType::FillAndKill)
-			{
-				CancelOrder(order->GetOrderID());
-			}
-		}
-	}
+	AddOrder(order, trades);
 	return trades;
 }
-Orderbook::Orderbook() : ordersPruneThread_{[this]
-											{ PruneGoodForDayOrders(); }} {}
-Orderbook::~Orderbook()
+Trades Orderbook::AddOrder(OrderPointer order)
 {
-	shutdownConditionVariable_.notify_one(); // notify the prune thread to wake up
-	ordersPruneThread_.join();				 // wait for the prune thread to finish
+	return AddOrder(*order);
 }
-
-Trades Orderbook::AddOrder(OrderPointer order)
+void Orderbook::CancelOrder(OrderId orderId)
 {
-	std::scoped_lock ordersLock{ordersMutex_};
-	if (orders_.contains(order->GetOrderID())) // order already exists
-	{
-		return {};
-	}
-	if (order->GetOrderType() == OrderType::FillAndKill && !CanMatch(order->GetSide(), order->GetPrice())) // FillAndKill order cannot be matched
+	const auto ordersLock = LockBook();
+	const std::size_t tombstones = core_.TombstoneCount();
+	core_.CancelOrder(orderId);
+	NotifyIfCompactionDue(tombstones);
+	PublishSnapshot();
+}
+Trades Orderbook::ModifyOrder(OrderModify order)
+{
+	Trades trades;
+	ModifyOrder(order, trades);
+	return trades;
+}
+void Orderbook::ApplyCommands(std::span<const Command> commands, CommandResults &results, Trades &trades)
+{
+	auto passes = [this](const Command &command)
+	{ return !preTrade_ || preTrade_->Validate(command) == PreTradeCheck::Result::Passed; };
+	const bool allPass = std::ranges::all_of(commands, passes); // the common case, the batch goes to the core whole
+	const auto ordersLock = LockBook();
+	const auto nextExpiry = core_.NextExpiry();
+	const std::size_t tombstones = core_.TombstoneCount();
+	if (allPass)
 	{
-		return {};
+		core_.Apply(commands, results, trades);
 	}
-	if (order->GetOrderType() == OrderType::FillOrKill && !CanFullyFill(order->GetSide(), order->GetPrice(), order->GetInitialQuantity()))
+	else
 	{
-		return {};
+		results.reserve(results.size() + commands.size());
+		for (const auto &command : commands)
+		{
+			if (passes(command))
+			{
+				core_.Apply(std::span{&command, 1}, results, trades);
+				continue;
+			}
+			ORDERBOOK_STATS_ONLY(preTradeRejects_.fetch_add(1, std::memory_order_relaxed);)
+			results.push_back(CommandResult{false, trades.size(), 0});
+		}
 	}
-	OrderPointers::iterator iterator;
-	if (order->GetSide() == Side::Buy) // add to bids
+	NotifyIfExpiryMoved(nextExpiry);
+	NotifyIfCompactionDue(tombstones);
+	PublishSnapshot();
+}
+std::size_t Orderbook::ApplyPackets(std::span<const std::span<const std::byte>> packets, OrderEntry::Reader &reader, CommandResults &results,
+								   Trades &trades)
+{
+	const auto ordersLock = LockBook();
+	const auto nextExpiry = core_.NextExpiry();
+	const std::size_t tombstones = core_.TombstoneCount();
+	auto passes = [this](PreTradeCheck::Result result)
 	{
-		auto &orders = bids_[order->GetPrice()];
-		orders.push_back(order);
-		iterator = std::next(orders.begin(), orders.size() - 1);
-	}
-	else // add to asks
+		ORDERBOOK_STATS_ONLY(if (result != PreTradeCheck::Result::Passed) { preTradeRejects_.fetch_add(1, std::memory_order_relaxed); })
+		return result == PreTradeCheck::Result::Passed;
+	};
+	std::size_t read = 0;
+	for (const auto packet : packets)
 	{
-		auto &orders = asks_[order->GetPrice()];
-		orders.push_back(order);
-		iterator = std::next(orders.begin(), orders.size() - 1);
+		if (!preTrade_)
+		{
+			read += core_.Apply(packet, reader, results, trades);
+			continue;
+		}
+		read += reader.Read(packet, [&]<typename M>(const M &message)
+							{
+								const std::size_t firstTrade = trades.size();
+								bool applied = false;
+								if constexpr (std::is_same_v<M, OrderEntry::CancelMessage>)
+								{
+									applied = core_.CancelOrder(message.GetOrderID());
+								}
+								else if constexpr (std::is_same_v<M, OrderEntry::AddMessage>) // checked as it lies in the packet
+								{
+									applied = passes(preTrade_->Validate(message)) && core_.AddOrder(message, trades);
+								}
+								else // as the order it would re-add, like ModifyOrder
+								{
+									applied = passes(preTrade_->Validate(message.ToCommand())) && core_.ModifyOrder(message, trades);
+								}
+								results.push_back(CommandResult{applied, firstTrade, trades.size() - firstTrade}); });
 	}
-	orders_.insert({order->GetOrderID(), OrderEntry{order, iterator}});
-	OnOrderAdded(order);
-	return MatchOrders();
+	NotifyIfExpiryMoved(nextExpiry);
+	NotifyIfCompactionDue(tombstones);
+	PublishSnapshot();
+	return read;
 }
-void Orderbook::CancelOrder(OrderId orderId)
+std::size_t Orderbook::ReplayJournal(const std::string &path, std::uint64_t fromRecord)
 {
-	std::scoped_lock ordersLock{ordersMutex_};
-	CancelOrderInternal(orderId);
+	const auto ordersLock = LockBook();
+	const auto nextExpiry = core_.NextExpiry();
+	const std::size_t applied = Journal::Replay(path, core_, fromRecord);
+	NotifyIfExpiryMoved(nextExpiry);
+	PublishSnapshot();
+	return applied;
 }
-Trades Orderbook::ModifyOrder(OrderModify order)
+void Orderbook::SaveSnapshot(const std::string &path) const
 {
-	OrderType orderType;
-	{
-		std::scoped_lock ordersLock{ordersMutex_};
-		if (!orders_.contains(order.GetOrderID())) // order does not exist
-		{
-			return {};
-		}
-		const auto &[existingOrder, _] = orders_.at(order.GetOrderID());
-		orderType = existingOrder->GetOrderType();
-	}
-	CancelOrder(order.GetOrderID());
-	return AddOrder(order.ToOrderPointer(orderType));
+	// the book stays locked while it is written out, the file and the journal position agree exactly
+	const auto ordersLock = LockBook();
+	SnapshotFile::Save(core_, path);
+}
+std::uint64_t Orderbook::LoadSnapshot(const std::string &path)
+{
+	const auto ordersLock = LockBook();
+	const auto nextExpiry = core_.NextExpiry();
+	const std::uint64_t journalPosition = SnapshotFile::Load(path, core_);
+	NotifyIfExpiryMoved(nextExpiry);
+	PublishSnapshot();
+	return journalPosition;
 }
 std::size_t Orderbook::Size() const
 {
-	std::scoped_lock ordersLock{ordersMutex_};
-	return orders_.size();
+	const auto ordersLock = LockBook();
+	return core_.Size();
 }
 OrderbookLevelInfos Orderbook::GetOrderInfos() const
 {
-	LevelInfos bidInfos, askInfos;
-	bidInfos.reserve(orders_.size());
-	askInfos.reserve(orders_.size());
-
-	auto CreateLevelInfos = [](Price price, const OrderPointers &orders)
-	{
-		return LevelInfo{
-			price, std::accumulate(orders.begin(), orders.end(), (Quantity)0,
-								   [](Quantity runningSum, const OrderPointer &order)
-								   { return runningSum + order->GetRemainingQuantity(); })};
-	};
-	for (const auto &[price, orders] : bids_)
-	{
-		bidInfos.push_back(CreateLevelInfos(price, orders));
-	}
-	for (const auto &[price, orders] : asks_)
-	{
-		askInfos.push_back(CreateLevelInfos(price, orders));
-	}
-	return OrderbookLevelInfos(bidInfos, askInfos);
-}
\ No newline at end of file
+	const auto ordersLock = LockBook();
+	return core_.GetOrderInfos();
+}
+OrderbookLevelInfos Orderbook::GetTopN(std::size_t levels) const
+{
+	const auto ordersLock = LockBook();
+	return core_.GetTopN(levels);
+}
+BestBidAsk Orderbook::GetBestBidAsk() const
+{
+	const auto ordersLock = LockBook();
+	return core_.GetBestBidAsk();
+}
+OrderbookStats Orderbook::GetStats() const
+{
+	const auto ordersLock = LockBook();
+	OrderbookStats stats = core_.GetStats();
+	ORDERBOOK_STATS_ONLY(stats.lockWait_ = lockWait_;
+						 stats.pruneSweeps_ = pruneSweeps_;
+						 stats.preTradeRejects_ = preTradeRejects_.load(std::memory_order_relaxed);)
+	return stats;
+}
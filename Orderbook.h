@@ -1,63 +1,79 @@
 #pragma once
 
-#include <map>
-#include <unordered_map>
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <string>
 #include <thread>
 #include <condition_variable>
 #include <mutex>
+#include <optional>
 
 #include "Usings.h"
+#include "BestBidAsk.h"
+#include "BookSnapshot.h"
+#include "Command.h"
+#include "Journal.h"
+#include "ExecutionReport.h"
+#include "LevelDelta.h"
 #include "Order.h"
 #include "OrderModify.h"
+#include "OrderbookConfig.h"
+#include "OrderbookCore.h"
 #include "OrderbookLevelInfos.h"
+#include "OrderbookStats.h"
+#include "PreTradeCheck.h"
+#include "Seqlock.h"
+#include "SnapshotFile.h"
+#include "ThreadPlacement.h"
 #include "Trade.h"
 
+class ScopedPin;
+
+// thread-safe orderbook: every call takes ordersMutex_ once and runs on the single-threaded core,
+// a background thread cancels the good for day orders at the close and good till date orders at their expiry,
+// and with lazy cancels reclaims the tombstones they leave in the levels
+// the matching runs on the callers' threads, ThreadPlacement only places the book's memory and the prune thread
+// use MatchingEngine instead to feed a core from several threads without a lock
 class Orderbook
 {
 private:
-	struct OrderEntry // a single order entry in the orderbook
-	{
-		OrderPointer order_{nullptr}; // the order pointer
-		OrderPointers::iterator location_; // the location of the order in the orderbook
-	};
-	struct LevelData // metadata for each price level
-	{
-		Quantity quantity_{};
-		Quantity count_{};
-
-		enum class Action
-		{
-			Add,
-			Remove,
-			Match,
-		};
-	};
-	std::unordered_map<Price, LevelData> data_;
-	std::map<Price, OrderPointers, std::greater<Price>> bids_; // bids are sorted in descending order to get the best bid price
-	std::map<Price, OrderPointers, std::less<Price>> asks_;	   // asks are sorted in ascending order to get the best ask price
-	std::unordered_map<OrderId, OrderEntry> orders_;
+	OrderbookCore core_;
 
 	mutable std::mutex ordersMutex_;
-	std::thread ordersPruneThread_;
 	std::condition_variable shutdownConditionVariable_;
 	std::atomic<bool> shutdown_{false};
+	// written with ordersMutex_ held, read by anyone without it
+	// a reader on another core never contends for the book lock, it only retries while a publish is in flight
+	const bool publishSnapshot_;
+	Seqlock<BookSnapshot> snapshot_;
+	std::uint64_t snapshotVersion_{0};
+	// OrderbookConfig::preTrade_, run by the calling thread before it takes ordersMutex_
+	// an immediate order is also screened against snapshot_ when publishSnapshot_ keeps it up to date
+	const std::optional<PreTradeCheck> preTrade_;
+	ORDERBOOK_STATS_ONLY(mutable LatencyHistogram lockWait_; // with ordersMutex_ held
+						 std::uint64_t pruneSweeps_{0};
+						 mutable std::atomic<std::uint64_t> preTradeRejects_{0};) // counted without the lock
+	// declared last: it starts in the constructor and uses everything above
+	// not started at all with ThreadPlacement::inlineHousekeeping_, the owner calls RunHousekeeping instead
+	std::thread ordersPruneThread_;
 
-	void PruneGoodForDayOrders();
-
-	void CancelOrders(OrderIds orderIds);
-	void CancelOrderInternal(OrderId orderId);
+	static constexpr std::size_t PruneChunk = 1024; // expired orders cancelled per lock acquisition
+	// with OrderbookConfig::lazyCancel_, the prune thread is woken to reclaim the tombstones once this many pile up
+	static constexpr std::size_t CompactThreshold = 1024;
+	static constexpr std::size_t CompactChunk = 1024; // tombstones released per lock acquisition
 
-	void OnOrderCancelled(OrderPointer order);
-	void OnOrderAdded(OrderPointer order);
-	void OnOrderMatched(Price price, Quantity quantity, bool isFullyFilled);
-	void UpdateLevelData(Price price, Quantity quantity, LevelData::Action action);
+	std::unique_lock<std::mutex> LockBook() const; // takes ordersMutex_, timing the wait with ORDERBOOK_STATS
+	void PruneExpiredOrders();
+	void NotifyIfExpiryMoved(std::optional<ExpiryTime> previous); // wake the prune thread for an earlier deadline
+	void NotifyIfCompactionDue(std::size_t previous);			  // wake the prune thread once the tombstones reach CompactThreshold
+	void PublishSnapshot();										  // with ordersMutex_ held, after a change to the book
+	bool PassesPreTrade(const Order &order) const;				  // without ordersMutex_, true when no pre-trade check is set
 
-	bool CanFullyFill(Side side, Price price, Quantity quantity) const;
-	bool CanMatch(Side side, Price price) const; // check if the order can be matched (for FillAndKill and ImmediateOrCancel orders)
-	Trades MatchOrders();
+	Orderbook(const OrderbookConfig &config, const ScopedPin &); // builds the book while the pin holds
 
 public:
-	Orderbook();
+	explicit Orderbook(OrderbookConfig config = {}, ThreadPlacement placement = {});
 	// delete copy constructor and assignment operator to prevent copying
 	// in our case, we don't need to copy the orderbook or move it around
 	// imagine we copy the orderbook, we would have two threads pruning good for day orders, then how to join? how to wait for the prune thread to finish...
@@ -68,10 +84,51 @@ public:
 	void operator=(Orderbook &&) = delete;
 	~Orderbook();
 
+	// the sink overloads append the fills to a caller-owned buffer instead of returning a new vector
+	// clear and reuse the same buffer across calls and trade reporting stops allocating once it has grown
+	void AddOrder(const Order &order, Trades &trades); // the order is copied into the book's pool, no allocation within capacity
+	void ModifyOrder(OrderModify order, Trades &trades);
+
+	Trades AddOrder(const Order &order);
 	Trades AddOrder(OrderPointer order);
 	void CancelOrder(OrderId orderId);
 	Trades ModifyOrder(OrderModify order);
 
+	// apply a batch of mixed commands in order under a single lock acquisition
+	// one result per command is appended to results, all fills go to trades (see CommandResult)
+	// with a pre-trade check the commands are validated before the lock, a failing one is rejected in its place
+	// (the snapshot screen is skipped, the batch's own earlier commands are not in the snapshot yet)
+	void ApplyCommands(std::span<const Command> commands, CommandResults &results, Trades &trades);
+	// the same for order-entry packets (see OrderEntry), read by reader in order under one lock and applied message by
+	// message straight from the packets; with a pre-trade check each message is validated as it is read, under the lock
+	// returns how many messages were applied or rejected, one result each
+	std::size_t ApplyPackets(std::span<const std::span<const std::byte>> packets, OrderEntry::Reader &reader, CommandResults &results, Trades &trades);
+
+	// rebuild the book from a journal written by a book with OrderbookConfig::journal_ (see Journal::Replay)
+	// meant for start-up, from the first record or from where a loaded snapshot left off; returns the records applied
+	std::size_t ReplayJournal(const std::string &path, std::uint64_t fromRecord = 0);
+	// warm start: save the resting book to a flat file, and load it into an empty book (see SnapshotFile)
+	// LoadSnapshot returns the journal position the snapshot covers, replay the journal tail from there
+	void SaveSnapshot(const std::string &path) const;
+	std::uint64_t LoadSnapshot(const std::string &path);
+
+	// with ThreadPlacement::inlineHousekeeping_, one bounded step of the prune thread's work under one lock acquisition:
+	// a chunk of the due expiries and of the tombstones past the threshold; true when more is left, call again when idle
+	bool RunHousekeeping();
+
 	std::size_t Size() const;
 	OrderbookLevelInfos GetOrderInfos() const;
+	OrderbookLevelInfos GetTopN(std::size_t levels) const; // the best `levels` levels of each side, from the level totals
+	BestBidAsk GetBestBidAsk() const;
+	// counters and latency histograms of the book and its lock, see OrderbookStats (only gauges without ORDERBOOK_STATS)
+	OrderbookStats GetStats() const;
+	// the last published top of the book, without taking ordersMutex_
+	// only kept up to date with OrderbookConfig::publishSnapshot_, empty (version_ 0) otherwise
+	BookSnapshot GetSnapshot() const { return snapshot_.Load(); }
+	// the next level change, lock-free, from a single market-data publisher thread
+	// only fed with OrderbookConfig::deltaRingCapacity_ set, see OrderbookCore::TryPollDelta
+	bool TryPollDelta(LevelDelta &delta) { return core_.TryPollDelta(delta); }
+	// the next execution report, lock-free, from one gateway thread, which splits the book's stream into sessions by owner_
+	// only fed with OrderbookConfig::executionReportCapacity_ set, see OrderbookCore::TryPollExecutionReport
+	bool TryPollExecutionReport(ExecutionReport &report) { return core_.TryPollExecutionReport(report); }
 };
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+
+#include "SelfTradePrevention.h"
+#include "Usings.h"
+
+class Journal;
+
+// a bounded tick band, for instruments whose prices are known to stay within it
+struct LadderConfig
+{
+    Price basePrice_{};          // lowest price the book accepts
+    Price tickSize_{1};          // prices must sit on basePrice_ + n * tickSize_
+    std::size_t levelCount_{0};  // number of ticks in the band, the highest price is basePrice_ + (levelCount_ - 1) * tickSize_
+
+    bool Accepts(Price price) const // inside the band and on its tick grid
+    {
+        return price >= basePrice_ && (price - basePrice_) % tickSize_ == 0 &&
+               static_cast<std::size_t>((price - basePrice_) / tickSize_) < levelCount_;
+    }
+};
+
+// limits an order must keep to before it reaches the book, checked without looking at the book (see PreTradeCheck)
+struct PreTradeLimits
+{
+    Quantity maxQuantity_{std::numeric_limits<Quantity>::max()};
+    std::int64_t maxNotional_{std::numeric_limits<std::int64_t>::max()}; // price * quantity, priced orders only
+    Price minPrice_{std::numeric_limits<Price>::min()};                  // the band a priced order must sit in
+    Price maxPrice_{std::numeric_limits<Price>::max()};
+};
+
+struct OrderbookConfig
+{
+    std::size_t orderCapacity_{1 << 16}; // orders the book pre-allocates room for, adds and cancels below this never allocate
+    std::optional<LadderConfig> ladder_; // when set, both sides use a flat array of levels and orders outside the band are rejected
+    bool publishSnapshot_{false};        // when set, the threaded front ends publish a BookSnapshot after every change, readable without a lock
+    std::size_t deltaRingCapacity_{0};   // when non-zero, every level change is published as a LevelDelta to a ring this large
+    std::size_t executionReportCapacity_{0}; // when non-zero, fills and dropped quantity are reported as ExecutionReports to a ring this large
+    Journal *journal_{nullptr};          // when set, every change of the book is appended to it, one journal per book, it must outlive the book
+    std::optional<Price> marketCollar_;  // when set, a market order trades no further than this from the touch it arrives at, never negative
+    std::size_t directOrderIdWindow_{0}; // when non-zero, ids are dense and increasing and index this many slots directly (see OrderIndex)
+    bool lazyCancel_{false};             // when set, a cancel leaves its order linked as a tombstone, see OrderbookCore::CompactLevels
+    // what the book does when an aggressor meets a resting order of its own owner, checked as the sweep meets each order
+    SelfTradePrevention selfTradePrevention_{SelfTradePrevention::None};
+    // when set, Orderbook screens every add and modify on the calling thread before it takes its lock (see PreTradeCheck)
+    std::optional<PreTradeLimits> preTrade_;
+};
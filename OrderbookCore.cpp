@@ -0,0 +1,985 @@
+#include "OrderbookCore.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <ctime>
+#include <format>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+	Quantity Traded(std::span<const Trade> fills) // one order's fills, each names it on one side
+	{
+		Quantity traded = 0;
+		for (const Trade &trade : fills)
+		{
+			traded += trade.GetBidTrade().quantity_;
+		}
+		return traded;
+	}
+}
+
+ExpiryTime OrderbookCore::NextGoodForDayExpiry(ExpiryTime now)
+{
+	using namespace std::chrono;
+	const auto end = hours(16);						 // close of the market
+	const auto now_c = system_clock::to_time_t(now); // current time in seconds
+	std::tm now_parts;								 // current time in parts
+	localtime_r(&now_c, &now_parts);				 // convert current time to parts
+	if (now_parts.tm_hour >= end.count())
+	{
+		now_parts.tm_mday += 1; // if the current time is after the close of the market, we need to increment the day (waiting for the next day)
+	}
+
+	now_parts.tm_hour = end.count(); // set the hour to 4 pm
+	now_parts.tm_min = 0;			 // exact time of 4 pm
+	now_parts.tm_sec = 0;
+	return system_clock::from_time_t(mktime(&now_parts)); // today at 4 pm, or tomorrow at 4 pm if the current time is after the close of the market
+}
+std::size_t OrderbookCore::ExpireOrders(ExpiryTime now, std::size_t maxOrders)
+{
+	const DeltaScope deltas{*this}; // the whole chunk is one update
+	std::size_t expired = 0;
+	while (expired < maxOrders && !expiry_.empty() && expiry_.Earliest() <= now) // only the due buckets are touched
+	{
+		RestingOrder *order = expiry_.EarliestOrder();
+		if (reports_)
+		{
+			ReportCancel(order, pool_.Remaining(order));
+		}
+		CancelOrder(order->GetOrderID());
+		++expired;
+	}
+	ORDERBOOK_STATS_ONLY(stats_.expired_ += expired;)
+	return expired;
+}
+std::optional<ExpiryTime> OrderbookCore::NextExpiry() const
+{
+	if (expiry_.empty())
+	{
+		return std::nullopt;
+	}
+	return expiry_.Earliest();
+}
+void OrderbookCore::CancelOrders(const OrderIds &orderIds) // cancel multiple orders
+{
+	const DeltaScope deltas{*this};
+	for (const auto &orderId : orderIds)
+	{
+		CancelOrder(orderId);
+	}
+}
+bool OrderbookCore::CancelOrder(OrderId orderId)
+{
+	ORDERBOOK_STATS_ONLY(const ScopedTicks timer{stats_.cancel_};)
+	const DeltaScope deltas{*this};
+	RestingOrder *order = orders_.Find(orderId);
+	if (!order) // order does not exist
+	{
+		return false;
+	}
+	const OrderDetails &details = pool_.Details(order);
+	if (IsStop(details.orderType_)) // still waiting for its trigger, it is in no level
+	{
+		BySide(details.side_, [&]<Side S>(SideConstant<S>)
+			   { SideStops<S>().Remove(order, details.stopPrice_); });
+		ReleaseOrder(order);
+	}
+	else
+	{
+		BySide(details.side_, [&]<Side S>(SideConstant<S>)
+			   { Cancel<S>(order); });
+	}
+	Record(JournalRecord::Cancel(orderId));
+	ORDERBOOK_STATS_ONLY(++stats_.cancels_;)
+	return true;
+}
+template <Side S>
+void OrderbookCore::Cancel(RestingOrder *order)
+{
+	auto &levels = SideLevels<S>();
+	const Price price = pool_.Details(order).price_;
+	PriceLevel &level = levels.Level(price);
+	OnOrderCancelled<S>(level, price, order->GetRemainingQuantity());
+	if (!lazyCancel_)
+	{
+		levels.Remove(order, price); // the level goes away with its last order
+		ReleaseOrder(order);
+		return;
+	}
+	// the order keeps its place in the queue, unlinking it is left to whoever passes it next
+	Unindex(order);
+	order->Kill();
+	++tombstones_;
+	if (level.data_.count_ == 0) // it was the last live order, the level goes now and its tombstones with it
+	{
+		DropTombstones<S>(level, price);
+	}
+	else if (level.orders_.size() == level.data_.count_ + std::size_t{1}) // the level's first tombstone
+	{
+		tombstonedLevels_.push_back(TombstonedLevel{S, price});
+	}
+}
+template <Side S>
+void OrderbookCore::DropTombstones(PriceLevel &level, Price price)
+{
+	tombstones_ -= level.orders_.size();
+	SideLevels<S>().Drop(price, [this](RestingOrder *tombstone)
+						 { pool_.Release(tombstone); });
+}
+template <Side S>
+bool OrderbookCore::CompactLevel(Price price, std::size_t maxOrders, std::size_t &released)
+{
+	PriceLevel *level = SideLevels<S>().Find(price);
+	if (!level || level->orders_.size() == level->data_.count_) // gone, or dropped and rebuilt since it was queued
+	{
+		return true;
+	}
+	const std::size_t erased = level->orders_.erase_if([](const RestingOrder &order)
+													   { return order.IsFilled(); },
+													   [this](RestingOrder *tombstone)
+													   { pool_.Release(tombstone); },
+													   maxOrders);
+	tombstones_ -= erased;
+	released += erased;
+	return level->orders_.size() == level->data_.count_;
+}
+std::size_t OrderbookCore::CompactLevels(std::size_t maxOrders)
+{
+	std::size_t released = 0;
+	while (released < maxOrders && !tombstonedLevels_.empty())
+	{
+		const auto [side, price] = tombstonedLevels_.back();
+		const bool compacted = BySide(side, [&]<Side S>(SideConstant<S>)
+									  { return CompactLevel<S>(price, maxOrders - released, released); });
+		if (compacted) // otherwise the budget ran out within the level, it stays queued for the next call
+		{
+			tombstonedLevels_.pop_back();
+		}
+	}
+	return released;
+}
+void OrderbookCore::Unindex(RestingOrder *order)
+{
+	orders_.Erase(order->GetOrderID());
+	expiry_.Remove(order);
+}
+void OrderbookCore::ReleaseOrder(RestingOrder *order)
+{
+	Unindex(order);
+	pool_.Release(order); // the slot goes back to the free list for the next add
+}
+template <Side S>
+void OrderbookCore::OnOrderCancelled(PriceLevel &level, Price price, Quantity remaining)
+{
+	UpdateLevelData<S>(level, price, remaining, LevelData::Action::Remove);
+}
+template <Side S>
+void OrderbookCore::OnOrderAdded(PriceLevel &level, Price price, Quantity remaining)
+{
+	UpdateLevelData<S>(level, price, remaining, LevelData::Action::Add); // a residual rests with what is left
+}
+template <Side S>
+void OrderbookCore::OnOrderMatched(PriceLevel &level, Price price, Quantity quantity, bool filled)
+{
+	UpdateLevelData<S>(level, price, quantity, filled ? LevelData::Action::Remove : LevelData::Action::Match);
+}
+template <Side S>
+void OrderbookCore::OnOrderAmended(PriceLevel &level, Price price, Quantity reduction)
+{
+	UpdateLevelData<S>(level, price, reduction, LevelData::Action::Amend);
+}
+template <Side S>
+void OrderbookCore::UpdateLevelData(PriceLevel &level, Price price, Quantity quantity, LevelData::Action action)
+{
+	LevelData &data = level.data_;
+	if (deltas_ && !data.deltaPending_) // the first change of this level in the current command
+	{
+		data.deltaPending_ = true;
+		pendingDeltas_.push_back(PendingDelta{S, price, data.count_ != 0});
+	}
+	data.count_ += action == LevelData::Action::Remove ? -1 : action == LevelData::Action::Add ? 1
+																							   : 0;
+	if (action != LevelData::Action::Add)
+	{
+		data.quantity_ -= quantity;
+	}
+	else
+	{
+		data.quantity_ += quantity;
+	}
+	SideLevels<S>().SyncQuantity(level); // a ladder keeps the quantities in an array of their own too, for LevelScan
+	// no erase here, the data goes away with its level once the last order leaves
+}
+void OrderbookCore::FlushDeltas()
+{
+	for (const auto &[side, price, existed] : pendingDeltas_)
+	{
+		// the level's state now, after every change of the command; a level that went away is sent as empty
+		PriceLevel *level = BySide(side, [&]<Side S>(SideConstant<S>)
+								   { return SideLevels<S>().Find(price); });
+		if (level && !level->data_.deltaPending_) // erased and re-created within the command, the new level was sent already
+		{
+			continue;
+		}
+		LevelDelta delta{0, side, price, 0, 0};
+		if (level)
+		{
+			level->data_.deltaPending_ = false;
+			delta.quantity_ = level->data_.quantity_;
+			delta.count_ = level->data_.count_;
+		}
+		if (!existed && delta.count_ == 0) // e.g. an aggressor that was inserted and then fully filled
+		{
+			continue;
+		}
+		delta.sequence_ = ++deltaSequence_;
+		deltas_->TryPush(delta); // dropped on a full ring, the sequence number still moved on
+	}
+	pendingDeltas_.clear();
+}
+template <Side S>
+bool OrderbookCore::CanFullyFill(Price price, Quantity quantity) const
+{
+	// go through the price levels in price order, from the best opposite level to your price
+	// in buy side, we want to go from best ask to your bidding price
+	// in sell side, we want to go from best bid to your asking price
+	// so the walk only touches the levels the order would actually reach
+	const auto &levels = SideLevels<Opposite(S)>();
+	if (levels.IsLadder()) // one vector scan over the quantities from the best level to the limit's
+	{
+		return levels.Reaches(price, quantity);
+	}
+	bool canFill = false;
+	levels.ForEachLevel([&](Price levelPrice, const PriceLevel &level)
+						{
+		if (!levels.IsWithin(levelPrice, price)) // this level and every level after it are worse than your price
+		{
+			return false;
+		}
+		if (quantity <= level.data_.quantity_)
+		{
+			canFill = true;
+			return false;
+		}
+		quantity -= level.data_.quantity_;
+		return true; });
+	return canFill;
+}
+template <Side S, SelfTradePrevention Stp>
+bool OrderbookCore::CanFullyFill(Price price, Quantity quantity, OwnerId owner) const
+{
+	if (Stp == SelfTradePrevention::None || !owner)
+	{
+		return CanFullyFill<S>(price, quantity);
+	}
+	const auto &levels = SideLevels<Opposite(S)>();
+	bool canFill = false;
+	levels.ForEachLevel([&](Price levelPrice, const PriceLevel &level)
+						{
+		if (!levels.IsWithin(levelPrice, price))
+		{
+			return false;
+		}
+		for (const RestingOrder &resting : level.orders_) // in the order the sweep meets them, the slices on show only
+		{
+			if (resting.IsFilled()) // a tombstone
+			{
+				continue;
+			}
+			if (pool_.Details(&resting).owner_ == owner)
+			{
+				if (Stp == SelfTradePrevention::CancelOldest)
+				{
+					continue;
+				}
+				return false;
+			}
+			if (quantity <= resting.GetRemainingQuantity())
+			{
+				canFill = true;
+				return false;
+			}
+			quantity -= resting.GetRemainingQuantity();
+		}
+		return true; });
+	return canFill;
+}
+template <Side S>
+bool OrderbookCore::CanMatch(Price price) const
+{
+	const auto &levels = SideLevels<Opposite(S)>();
+	return !levels.empty() && levels.IsWithin(levels.BestPrice(), price); // compare with the best opposite price
+}
+template <Side S, OrderType Type, SelfTradePrevention Stp, typename O>
+Quantity OrderbookCore::Sweep(const O &order, Price limit, Trades &trades)
+{
+	ORDERBOOK_STATS_ONLY(const ScopedTicks timer{stats_.match_};
+						 const std::size_t firstTrade = trades.size();)
+	auto &levels = SideLevels<Opposite(S)>();
+	Quantity remaining = order.GetInitialQuantity();
+	Quantity traded = 0; // not initial less remaining, self-trade prevention may have taken some of that
+	while (remaining && !levels.empty())
+	{
+		const Price price = levels.BestPrice();
+		if (!levels.IsWithin(price, limit)) // this level and every level after it are worse than the limit
+		{
+			break;
+		}
+		// fill from the front of the level until it runs out, PopBest drops the level with its last order
+		PriceLevel &level = levels.BestLevel();
+		auto &[orders, data] = level;
+		bool levelRemains = true;
+		while (remaining && levelRemains)
+		{
+			RestingOrder *resting = orders.front();
+			if (resting->IsFilled()) // a tombstone, cancelled lazily, only its slot is left to give back
+			{
+				levelRemains = orders.size() > 1;
+				levels.PopBest();
+				pool_.Release(resting);
+				--tombstones_;
+				continue;
+			}
+			if constexpr (Stp != SelfTradePrevention::None)
+			{
+				// the owner is with the details, read only when the aggressor has one
+				if (order.GetOwner() && pool_.Details(resting).owner_ == order.GetOwner())
+				{
+					if constexpr (Stp == SelfTradePrevention::CancelNewest)
+					{
+						remaining = 0;
+						break;
+					}
+					else
+					{
+						// cancel oldest takes the resting order out whole, decrement both takes the smaller quantity off each
+						const Quantity restingRemaining = pool_.Remaining(resting);
+						const Quantity decrement = Stp == SelfTradePrevention::CancelOldest ? restingRemaining : std::min(remaining, restingRemaining);
+						if constexpr (Stp == SelfTradePrevention::DecrementBoth)
+						{
+							remaining -= decrement;
+						}
+						if (reports_) // the aggressor's share is reported once its sweep is over
+						{
+							ReportCancel(resting, decrement);
+						}
+						if (decrement < restingRemaining) // it keeps its place, what is left on show never reaches 0 (see Amend)
+						{
+							Amend<Opposite(S)>(resting, restingRemaining - decrement);
+							Record(JournalRecord::Amend(resting->GetOrderID(), restingRemaining - decrement));
+							continue;
+						}
+						// as with a fill, the cancel drops the level with its last live order
+						levelRemains = data.count_ > 1;
+						CancelOrder(resting->GetOrderID());
+						continue;
+					}
+				}
+			}
+			const Quantity quantity = std::min(remaining, resting->GetRemainingQuantity());
+			resting->Fill(quantity);
+			remaining -= quantity;
+			traded += quantity;
+			lastTradePrice_ = price;
+			// a market order has no price of its own, it prints at the resting order's
+			const TradeInfo taker{order.GetOrderID(), Type == OrderType::Market ? price : order.GetPrice(), quantity};
+			const TradeInfo maker{resting->GetOrderID(), price, quantity};
+			if constexpr (S == Side::Buy)
+			{
+				trades.push_back(Trade{taker, maker});
+			}
+			else
+			{
+				trades.push_back(Trade{maker, taker});
+			}
+			OnOrderMatched<Opposite(S)>(level, price, quantity, resting->IsFilled());
+			Record(JournalRecord::Fill(trades.back()));
+			if (reports_) // the resting order's totals are in its details, an iceberg's reserve is still open
+			{
+				const OrderDetails &details = pool_.Details(resting);
+				const Quantity leaves = pool_.Remaining(resting);
+				const std::uint64_t execId = ++execSequence_;
+				Report(ExecutionReport{0, execId, resting->GetOrderID(), details.owner_, ExecutionReport::Kind::Fill, Opposite(S), price, quantity, leaves,
+									   details.initialQuantity_ - leaves, leaves == 0});
+				// what decrements took is reported as cancelled after the sweep, that report is the aggressor's last then
+				Report(ExecutionReport{0, execId, order.GetOrderID(), order.GetOwner(), ExecutionReport::Kind::Fill, S, price, quantity, remaining,
+									   traded, traded == order.GetInitialQuantity()});
+			}
+			if (resting->IsFilled())
+			{
+				if (OrderDetails &details = pool_.Details(resting); details.reserve_) // an iceberg, its next slice joins the back of the level
+				{
+					orders.pop_front();
+					Refill(resting, details);
+					orders.push_back(resting);
+					OnOrderAdded<Opposite(S)>(level, price, resting->GetRemainingQuantity());
+					continue;
+				}
+				// popping the last order drops the level, orders is gone after that; with lazy cancels the last live
+				// order may leave only tombstones behind, the level goes with them
+				const bool tombstonesOnly = data.count_ == 0 && orders.size() > 1;
+				levelRemains = data.count_ != 0;
+				levels.PopBest();
+				ReleaseOrder(resting);
+				if (tombstonesOnly)
+				{
+					DropTombstones<Opposite(S)>(levels.BestLevel(), price);
+				}
+			}
+		}
+	}
+	ORDERBOOK_STATS_ONLY(stats_.fills_ += trades.size() - firstTrade;)
+	return remaining;
+}
+void OrderbookCore::ReportCancel(const RestingOrder *order, Quantity cancelled)
+{
+	const OrderDetails &details = pool_.Details(order);
+	const Quantity remaining = pool_.Remaining(order);
+	Report(ExecutionReport{0, 0, order->GetOrderID(), details.owner_, ExecutionReport::Kind::Cancelled, details.side_, details.price_, cancelled,
+						   remaining - cancelled, details.initialQuantity_ - remaining, remaining == cancelled});
+}
+template <typename O>
+void OrderbookCore::ReportDropped(const O &order, std::span<const Trade> fills, Quantity leaves)
+{
+	const Quantity filled = Traded(fills);
+	if (const Quantity dropped = order.GetInitialQuantity() - filled - leaves; dropped)
+	{
+		Report(ExecutionReport{0, 0, order.GetOrderID(), order.GetOwner(), ExecutionReport::Kind::Cancelled, order.GetSide(), order.GetPrice(), dropped,
+							   leaves, filled, leaves == 0});
+	}
+}
+template <Side S>
+void OrderbookCore::Rest(RestingOrder *order, Price price, ExpiryTime expiry)
+{
+	OnOrderAdded<S>(SideLevels<S>().Push(order, price), price, order->GetRemainingQuantity());
+	orders_.Insert(order);
+	if (expiry != ExpiryTime::max())
+	{
+		expiry_.Insert(order, expiry);
+	}
+}
+template <Side S>
+void OrderbookCore::FillResting(RestingOrder *order, Quantity quantity)
+{
+	auto &levels = SideLevels<S>();
+	const Price price = pool_.Details(order).price_;
+	order->Fill(quantity);
+	lastTradePrice_ = price; // replay leaves the stops where they are, their triggers and releases are journaled too
+	PriceLevel &level = levels.Level(price);
+	OnOrderMatched<S>(level, price, quantity, order->IsFilled());
+	if (order->IsFilled() && pool_.Details(order).reserve_) // as the sweep did, the iceberg's next slice goes to the back
+	{
+		level.orders_.erase(order);
+		Refill(order, pool_.Details(order));
+		level.orders_.push_back(order);
+		OnOrderAdded<S>(level, price, order->GetRemainingQuantity());
+		return;
+	}
+	if (order->IsFilled())
+	{
+		levels.Remove(order, price);
+		ReleaseOrder(order);
+		if (PriceLevel *level = levels.Find(price); lazyCancel_ && level && level->data_.count_ == 0 && !level->orders_.empty())
+		{
+			DropTombstones<S>(*level, price);
+		}
+	}
+}
+template <Side S>
+void OrderbookCore::Amend(RestingOrder *order, Quantity remaining)
+{
+	OrderDetails &details = pool_.Details(order);
+	const Quantity reduction = pool_.Remaining(order) - remaining;
+	const Quantity hidden = std::min(reduction, details.reserve_); // an iceberg gives up its reserve first, the slice on show last
+	details.reserve_ -= hidden;
+	details.initialQuantity_ -= reduction; // the filled quantity stays what it was
+	order->Amend(order->GetRemainingQuantity() - (reduction - hidden));
+	OnOrderAmended<S>(SideLevels<S>().Level(details.price_), details.price_, reduction - hidden);
+}
+void OrderbookCore::Refill(RestingOrder *order, OrderDetails &details)
+{
+	const Quantity slice = std::min(details.peak_, details.reserve_);
+	details.reserve_ -= slice;
+	order->Refill(slice);
+}
+OrderbookCore::OrderbookCore(const OrderbookConfig &config)
+	: pool_{config.orderCapacity_},
+	  bids_{config.ladder_, &nodeResource_},
+	  asks_{config.ladder_, &nodeResource_},
+	  orders_{config.orderCapacity_, config.directOrderIdWindow_}, // no rehash while the book stays within its capacity
+	  expiry_{pool_, &nodeResource_},
+	  buyStops_{&nodeResource_},
+	  sellStops_{&nodeResource_},
+	  goodForDayExpiry_{NextGoodForDayExpiry(std::chrono::system_clock::now())},
+	  marketCollar_{config.marketCollar_},
+	  journal_{config.journal_},
+	  lazyCancel_{config.lazyCancel_},
+	  selfTradePrevention_{static_cast<std::size_t>(config.selfTradePrevention_)}
+{
+	if (marketCollar_ && *marketCollar_ < 0) // it would turn the limit back through the touch
+	{
+		throw std::invalid_argument(std::format("Market collar {} cannot be negative", *marketCollar_));
+	}
+	if (config.deltaRingCapacity_)
+	{
+		deltas_ = std::make_unique<SpscRing<LevelDelta>>(config.deltaRingCapacity_);
+		pendingDeltas_.reserve(64); // grows to the widest sweep seen, then stays
+	}
+	if (config.executionReportCapacity_)
+	{
+		reports_ = std::make_unique<SpscRing<ExecutionReport>>(config.executionReportCapacity_);
+	}
+}
+
+bool OrderbookCore::AddOrder(const Order &order, Trades &trades)
+{
+	return Admit(order, trades);
+}
+bool OrderbookCore::AddOrder(const OrderEntry::AddMessage &order, Trades &trades)
+{
+	return Admit(order, trades);
+}
+template <typename O>
+bool OrderbookCore::Admit(const O &order, Trades &trades)
+{
+	ORDERBOOK_STATS_ONLY(const ScopedTicks timer{stats_.add_};)
+	const DeltaScope deltas{*this};
+	const bool added = Dispatch(order, trades);
+	ORDERBOOK_STATS_ONLY(++(added ? stats_.adds_ : stats_.addRejects_);)
+	if (added && AnyStopTriggered()) // the order traded through a stop, or a stop arrived already triggered
+	{
+		ReleaseStops(trades);
+	}
+	return added;
+}
+template <typename O>
+bool OrderbookCore::Dispatch(const O &order, Trades &trades)
+{
+	// one entry per self-trade prevention mode, side and order type, each specialised at compile time, so the path it
+	// takes carries no mode, side or type branches; the book's mode picks its row once, at construction
+	static constexpr auto table = []<std::size_t... Modes>(std::index_sequence<Modes...>)
+	{
+		return std::array{[]<std::size_t... Types>(std::index_sequence<Types...>)
+						  {
+							  constexpr auto stp = static_cast<SelfTradePrevention>(Modes);
+							  return std::array{std::array{&OrderbookCore::Add<Side::Buy, static_cast<OrderType>(Types), stp, O>...},
+												std::array{&OrderbookCore::Add<Side::Sell, static_cast<OrderType>(Types), stp, O>...}};
+						  }(std::make_index_sequence<OrderTypeCount>{})...};
+	}(std::make_index_sequence<SelfTradePreventionCount>{});
+
+	const auto side = static_cast<std::size_t>(order.GetSide());
+	const auto type = static_cast<std::size_t>(order.GetOrderType());
+	// not a side or an order type this book knows, or the order already exists
+	return selfTradePrevention_ < table.size() && side < table.front().size() && type < OrderTypeCount && !orders_.Contains(order.GetOrderID()) &&
+		   (this->*table[selfTradePrevention_][side][type])(order, trades);
+}
+void OrderbookCore::ReleaseStops(Trades &trades)
+{
+	auto release = [this](RestingOrder *stop)
+	{
+		const Order order = pool_.ToOrder(stop);
+		// it trades under its own id as what it turns into: a market order, or a limit order at its price that rests
+		// till cancelled, or till the expiry the stop carried
+		triggered_.push_back(order.GetOrderType() == OrderType::Stop ? Order{order.GetOrderID(), order.GetSide(), order.GetInitialQuantity()}
+							 : order.HasExpiry()					 ? Order{OrderType::GoodTillDate, order.GetOrderID(), order.GetSide(), order.GetPrice(), order.GetInitialQuantity(), order.GetExpiry()}
+																	 : Order{OrderType::GoodTillCancel, order.GetOrderID(), order.GetSide(), order.GetPrice(), order.GetInitialQuantity()});
+		triggered_.back().SetOwner(order.GetOwner());
+		Record(JournalRecord::Cancel(order.GetOrderID())); // replay takes it out of the stop index, its trades and rest follow
+		ReleaseOrder(stop);
+	};
+	while (AnyStopTriggered())
+	{
+		const Price price = *lastTradePrice_; // the whole batch is what this price reached, before any of it trades
+		buyStops_.Trigger(price, release);
+		sellStops_.Trigger(price, release);
+		for (const Order &order : triggered_)
+		{
+			// its stop is gone already, so one the book refuses (a market order with nothing to trade against) ends here
+			if (!Dispatch(order, trades))
+			{
+				if (reports_)
+				{
+					ReportDropped(order, {}, 0);
+				}
+				ORDERBOOK_STATS_ONLY(++stats_.stopsDropped_;)
+			}
+		}
+		ORDERBOOK_STATS_ONLY(stats_.stopsTriggered_ += triggered_.size();)
+		triggered_.clear();
+	}
+}
+template <Side S, typename O>
+bool OrderbookCore::AddStop(const O &order)
+{
+	// a stop limit may rest once triggered, its price must fit the ladder like any resting order's
+	if (order.GetOrderType() == OrderType::StopLimit && !SideLevels<S>().Accepts(order.GetPrice()))
+	{
+		return false;
+	}
+	RestingOrder *pooled = pool_.Acquire(order, order.GetInitialQuantity());
+	Arm<S>(pooled);
+	if (journal_)
+	{
+		Record(JournalRecord::Add(pool_.ToOrder(pooled)));
+	}
+	return true;
+}
+template <Side S>
+void OrderbookCore::Arm(RestingOrder *order)
+{
+	const OrderDetails &details = pool_.Details(order);
+	SideStops<S>().Insert(order, details.stopPrice_);
+	orders_.Insert(order);
+	if (details.expiry_ != ExpiryTime::max()) // expires while it waits like a resting order, ExpireOrders cancels it
+	{
+		expiry_.Insert(order, details.expiry_);
+	}
+}
+template <Side S, OrderType Type, SelfTradePrevention Stp, typename O>
+bool OrderbookCore::Add(const O &order, Trades &trades)
+{
+	const auto &opposite = SideLevels<Opposite(S)>();
+	if constexpr (IsStop(Type)) // waits off the book, AddOrder releases it once a trade reaches its stop price
+	{
+		return AddStop<S>(order);
+	}
+	else if constexpr (Type == OrderType::Market) // no price of its own, it never touches its own side or orders_
+	{
+		if (opposite.empty()) // nothing to trade against, like a fill and kill that cannot match
+		{
+			return false;
+		}
+		// the collar is measured from the touch at arrival, without one the sweep may empty the side
+		Price limit = S == Side::Buy ? std::numeric_limits<Price>::max() : std::numeric_limits<Price>::min();
+		if (marketCollar_) // worked out wide, a touch near the edge of the price range pins the limit to that edge
+		{
+			const std::int64_t reach = S == Side::Buy ? std::int64_t{opposite.BestPrice()} + *marketCollar_ : std::int64_t{opposite.BestPrice()} - *marketCollar_;
+			limit = static_cast<Price>(std::clamp<std::int64_t>(reach, std::numeric_limits<Price>::min(), std::numeric_limits<Price>::max()));
+		}
+		const std::size_t firstTrade = trades.size();
+		Sweep<S, Type, Stp>(order, limit, trades);
+		if (reports_) // what the sweep left is dropped
+		{
+			ReportDropped(order, std::span{trades}.subspan(firstTrade), 0);
+		}
+		return true;
+	}
+	else
+	{
+		// whatever an immediate order does not trade on arrival is dropped
+		constexpr bool immediate = Type == OrderType::FillAndKill || Type == OrderType::ImmediateOrCancel || Type == OrderType::FillOrKill;
+		if (!SideLevels<S>().Accepts(order.GetPrice())) // outside the ladder band or off its tick grid
+		{
+			return false;
+		}
+		const bool crosses = CanMatch<S>(order.GetPrice());
+		if (immediate && !crosses) // cannot be matched at all
+		{
+			return false;
+		}
+		if constexpr (Type == OrderType::FillOrKill)
+		{
+			if (!CanFullyFill<S, Stp>(order.GetPrice(), order.GetInitialQuantity(), order.GetOwner()))
+			{
+				ORDERBOOK_STATS_ONLY(++stats_.fillOrKillRejects_;)
+				return false;
+			}
+		}
+		if constexpr (Type == OrderType::Iceberg)
+		{
+			if (order.GetDisplayQuantity() == 0) // it would never show anything
+			{
+				return false;
+			}
+		}
+		// the aggressor trades against the opposite side first, only a resting residual ever reaches its own side or orders_
+		const std::size_t firstTrade = trades.size();
+		const Quantity remaining = crosses ? Sweep<S, Type, Stp>(order, order.GetPrice(), trades) : order.GetInitialQuantity();
+		if (reports_) // an immediate remainder is dropped, and self-trade prevention may have taken some of it
+		{
+			ReportDropped(order, std::span{trades}.subspan(firstTrade), immediate ? 0 : remaining);
+		}
+		if (immediate || remaining == 0)
+		{
+			return true;
+		}
+		// the book owns its copy from here on; what decrements took is gone, as with an amend, so the order rests as if it
+		// had come in without it, an iceberg's slices counted from its fills the way a replay of its journaled add counts them
+		const Quantity initial = Stp == SelfTradePrevention::DecrementBoth ? Traded(std::span{trades}.subspan(firstTrade)) + remaining : order.GetInitialQuantity();
+		RestingOrder *pooled = pool_.Acquire(order, initial, remaining);
+		ExpiryTime expiry = order.GetExpiry();
+		if constexpr (Type == OrderType::GoodForDay)
+		{
+			const auto now = std::chrono::system_clock::now();
+			if (now >= goodForDayExpiry_) // the cached close has passed, roll it to the next one
+			{
+				goodForDayExpiry_ = NextGoodForDayExpiry(now);
+			}
+			expiry = goodForDayExpiry_;
+		}
+		Rest<S>(pooled, order.GetPrice(), expiry);
+		if (journal_) // as it rests, after its fills; a good for day order carries its close from here on
+		{
+			Record(JournalRecord::Add(pool_.ToOrder(pooled)));
+		}
+		return true;
+	}
+}
+bool OrderbookCore::ModifyOrder(OrderModify order, Trades &trades)
+{
+	return Modify(order, trades);
+}
+bool OrderbookCore::ModifyOrder(const OrderEntry::ModifyMessage &order, Trades &trades)
+{
+	return Modify(order, trades);
+}
+template <typename M>
+bool OrderbookCore::Modify(const M &order, Trades &trades)
+{
+	ORDERBOOK_STATS_ONLY(const ScopedTicks timer{stats_.modify_};)
+	const DeltaScope deltas{*this}; // a cancel and re-add is one update
+	RestingOrder *existing = orders_.Find(order.GetOrderID());
+	if (!existing) // order does not exist
+	{
+		return false;
+	}
+	ORDERBOOK_STATS_ONLY(++stats_.modifies_;)
+	const OrderDetails &details = pool_.Details(existing);
+	if (!IsStop(details.orderType_) && order.GetSide() == details.side_ && order.GetPrice() == details.price_ &&
+		order.GetQuantity() > 0 && order.GetQuantity() <= pool_.Remaining(existing))
+	{
+		// the order only shrinks where it already rests: it keeps its place in the queue and cannot newly cross
+		BySide(details.side_, [&]<Side S>(SideConstant<S>)
+			   { Amend<S>(existing, order.GetQuantity()); });
+		Record(JournalRecord::Amend(existing->GetOrderID(), order.GetQuantity()));
+		return true;
+	}
+	// keeps a good till date order's expiry, an iceberg's peak, a stop's stop price and the owner
+	const Order replacement{details.orderType_, order.GetOrderID(), order.GetSide(), order.GetPrice(), order.GetQuantity(), details.expiry_, details.peak_, details.stopPrice_, details.owner_};
+	CancelOrder(order.GetOrderID());
+	return AddOrder(replacement, trades); // the order is built on the stack, no make_shared
+}
+bool OrderbookCore::Apply(const Command &command, Trades &trades)
+{
+	switch (command.type_)
+	{
+	case Command::Type::Add:
+		return AddOrder(command.ToOrder(), trades);
+	case Command::Type::Cancel:
+		return CancelOrder(command.orderId_);
+	case Command::Type::Modify:
+		return ModifyOrder(command.ToOrderModify(), trades);
+	}
+	return false;
+}
+void OrderbookCore::Apply(std::span<const Command> commands, CommandResults &results, Trades &trades)
+{
+	results.reserve(results.size() + commands.size());
+	for (const auto &command : commands)
+	{
+		const std::size_t firstTrade = trades.size();
+		const bool applied = Apply(command, trades);
+		results.push_back(CommandResult{applied, firstTrade, trades.size() - firstTrade});
+	}
+}
+std::size_t OrderbookCore::Apply(std::span<const std::byte> packet, OrderEntry::Reader &reader, CommandResults &results, Trades &trades)
+{
+	return reader.Read(packet, [&]<typename M>(const M &message)
+					   {
+						   const std::size_t firstTrade = trades.size();
+						   bool applied;
+						   if constexpr (std::is_same_v<M, OrderEntry::AddMessage>)
+						   {
+							   applied = AddOrder(message, trades);
+						   }
+						   else if constexpr (std::is_same_v<M, OrderEntry::ModifyMessage>)
+						   {
+							   applied = ModifyOrder(message, trades);
+						   }
+						   else
+						   {
+							   applied = CancelOrder(message.GetOrderID());
+						   }
+						   results.push_back(CommandResult{applied, firstTrade, trades.size() - firstTrade}); });
+}
+bool OrderbookCore::Restore(const JournalRecord &record)
+{
+	const DeltaScope deltas{*this};
+	Journal *journal = std::exchange(journal_, nullptr); // the records are in a journal already
+	bool restored = false;
+	switch (record.kind_)
+	{
+	case JournalRecord::Kind::Add:
+	{
+		if (orders_.Contains(record.orderId_))
+		{
+			break;
+		}
+		if (record.remaining_ > record.quantity_)
+		{
+			break;
+		}
+		// matched on arrival, it rests with what was left
+		RestingOrder *pooled = pool_.Acquire(record.ToOrder(), record.remaining_ ? record.remaining_ : record.quantity_);
+		if (IsStop(record.orderType_))
+		{
+			BySide(record.side_, [&]<Side S>(SideConstant<S>)
+				   { Arm<S>(pooled); });
+			restored = true;
+			break;
+		}
+		// a good for day order keeps the close it was booked with
+		BySide(record.side_, [&]<Side S>(SideConstant<S>)
+			   { Rest<S>(pooled, record.price_, record.expiry_); });
+		restored = true;
+		break;
+	}
+	case JournalRecord::Kind::Fill:
+	{
+		// the aggressor is not in the book yet (or never, a market or an immediate order), only its counterpart is
+		RestingOrder *bid = orders_.Find(record.orderId_);
+		RestingOrder *ask = orders_.Find(record.otherOrderId_);
+		if (!bid && !ask)
+		{
+			break;
+		}
+		if (bid)
+		{
+			FillResting<Side::Buy>(bid, record.quantity_);
+		}
+		if (ask)
+		{
+			FillResting<Side::Sell>(ask, record.quantity_);
+		}
+		restored = true;
+		break;
+	}
+	case JournalRecord::Kind::Cancel:
+		restored = CancelOrder(record.orderId_);
+		break;
+	case JournalRecord::Kind::Amend:
+	{
+		RestingOrder *order = orders_.Find(record.orderId_);
+		if (!order || record.quantity_ == 0 || record.quantity_ > pool_.Remaining(order))
+		{
+			break;
+		}
+		BySide(pool_.Details(order).side_, [&]<Side S>(SideConstant<S>)
+			   { Amend<S>(order, record.quantity_); });
+		restored = true;
+		break;
+	}
+	}
+	journal_ = journal;
+	return restored;
+}
+bool OrderbookCore::CanLoadOrder(const Order &order, Quantity remaining) const
+{
+	const OrderType type = order.GetOrderType();
+	if (static_cast<std::size_t>(type) >= OrderTypeCount || (order.GetSide() != Side::Buy && order.GetSide() != Side::Sell) ||
+		orders_.Contains(order.GetOrderID()))
+	{
+		return false;
+	}
+	if (IsStop(type)) // untriggered, it has not traded
+	{
+		return remaining == order.GetInitialQuantity() && (type == OrderType::Stop || bids_.Accepts(order.GetPrice()));
+	}
+	// only these rest, an immediate or a market order never does
+	const bool rests = type == OrderType::GoodTillCancel || type == OrderType::GoodForDay || type == OrderType::GoodTillDate ||
+					   (type == OrderType::Iceberg && order.GetDisplayQuantity() != 0);
+	return rests && bids_.Accepts(order.GetPrice()) && remaining != 0 && remaining <= order.GetInitialQuantity();
+}
+bool OrderbookCore::LoadOrder(const Order &order, Quantity remaining)
+{
+	const DeltaScope deltas{*this};
+	if (!CanLoadOrder(order, remaining))
+	{
+		return false;
+	}
+	if (IsStop(order.GetOrderType()))
+	{
+		BySide(order.GetSide(), [&]<Side S>(SideConstant<S>)
+			   { Arm<S>(pool_.Acquire(order, remaining)); });
+		return true;
+	}
+	RestingOrder *pooled = pool_.Acquire(order, remaining);
+	// the level holds what is left on show, not the initial size
+	BySide(order.GetSide(), [&]<Side S>(SideConstant<S>)
+		   { UpdateLevelData<S>(SideLevels<S>().Append(pooled, order.GetPrice()), order.GetPrice(), pooled->GetRemainingQuantity(), LevelData::Action::Add); });
+	orders_.Insert(pooled);
+	if (order.GetExpiry() != ExpiryTime::max())
+	{
+		expiry_.Insert(pooled, order.GetExpiry());
+	}
+	return true;
+}
+std::size_t OrderbookCore::Size() const
+{
+	return orders_.Size();
+}
+OrderbookLevelInfos OrderbookCore::GetOrderInfos() const
+{
+	return GetTopN(std::numeric_limits<std::size_t>::max());
+}
+OrderbookLevelInfos OrderbookCore::GetTopN(std::size_t levels) const
+{
+	LevelInfos bidInfos, askInfos;
+	auto CollectLevels = [levels](LevelInfos &infos)
+	{
+		return [&infos, levels](Price price, const PriceLevel &level)
+		{
+			infos.push_back(LevelInfo{price, level.data_.quantity_});
+			return infos.size() < levels;
+		};
+	};
+	if (levels)
+	{
+		bids_.ForEachLevel(CollectLevels(bidInfos));
+		asks_.ForEachLevel(CollectLevels(askInfos));
+	}
+	return OrderbookLevelInfos(bidInfos, askInfos);
+}
+BestBidAsk OrderbookCore::GetBestBidAsk() const
+{
+	BestBidAsk top;
+	if (!bids_.empty())
+	{
+		top.bid_ = LevelInfo{bids_.BestPrice(), bids_.BestLevel().data_.quantity_};
+	}
+	if (!asks_.empty())
+	{
+		top.ask_ = LevelInfo{asks_.BestPrice(), asks_.BestLevel().data_.quantity_};
+	}
+	return top;
+}
+BookSnapshot OrderbookCore::GetSnapshot() const
+{
+	BookSnapshot snapshot;
+	auto CollectLevels = [](auto &levels, std::uint32_t &count)
+	{
+		return [&levels, &count](Price price, const PriceLevel &level)
+		{
+			levels[count++] = LevelInfo{price, level.data_.quantity_};
+			return count < levels.size();
+		};
+	};
+	bids_.ForEachLevel(CollectLevels(snapshot.bids_, snapshot.bidCount_));
+	asks_.ForEachLevel(CollectLevels(snapshot.asks_, snapshot.askCount_));
+	return snapshot;
+}
+OrderbookStats OrderbookCore::GetStats() const
+{
+	OrderbookStats stats;
+	ORDERBOOK_STATS_ONLY(stats = stats_;
+						 stats.enabled_ = true;)
+	stats.orders_ = orders_.Size();
+	stats.bidLevels_ = bids_.LevelCount();
+	stats.askLevels_ = asks_.LevelCount();
+	stats.tombstones_ = tombstones_;
+	return stats;
+}
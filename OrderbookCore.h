@@ -0,0 +1,339 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <type_traits>
+
+#include "Usings.h"
+#include "BestBidAsk.h"
+#include "BookSnapshot.h"
+#include "Command.h"
+#include "ExecutionReport.h"
+#include "ExpiryIndex.h"
+#include "Journal.h"
+#include "JournalRecord.h"
+#include "LevelDelta.h"
+#include "Order.h"
+#include "OrderDetails.h"
+#include "OrderIndex.h"
+#include "OrderList.h"
+#include "OrderModify.h"
+#include "OrderPool.h"
+#include "OrderEntry.h"
+#include "OrderbookConfig.h"
+#include "OrderbookLevelInfos.h"
+#include "OrderbookStats.h"
+#include "PriceLevels.h"
+#include "SpscRing.h"
+#include "StopIndex.h"
+#include "Trade.h"
+
+// the matching logic of a single book, with no locking and no threads of its own
+// exactly one thread may touch a core at a time: Orderbook wraps it in ordersMutex_,
+// MatchingEngine owns it from its matching thread
+// the one exception is TryPollDelta, which belongs to a single market-data publisher thread
+class OrderbookCore
+{
+private:
+	OrderPool pool_; // every resting order lives here, its hot half linked into a level, its details beside it
+	// the node-based containers draw from a recycling pool, so a node freed by a cancel is reused by the next add
+	std::pmr::unsynchronized_pool_resource nodeResource_;
+	PriceLevels<std::greater<Price>> bids_; // bids are sorted in descending order to get the best bid price
+	PriceLevels<std::less<Price>> asks_;	// asks are sorted in ascending order to get the best ask price
+	OrderIndex orders_; // handles into pool_, the orders also carry their own level links
+	ExpiryIndex expiry_;				// good for day and good till date orders, by expiry time
+	// stop orders wait here, pooled and in orders_ like any order but in no level, until a trade reaches them
+	StopIndex<std::less<Price>> buyStops_;
+	StopIndex<std::greater<Price>> sellStops_;
+	std::optional<Price> lastTradePrice_; // the price of the book's last trade, what the stops are triggered by
+	std::vector<Order> triggered_;		  // the batch ReleaseStops is working through, kept for its capacity
+	ExpiryTime goodForDayExpiry_;		// the close the good for day orders added now expire at
+
+	// level deltas: every level a command touches is queued once, and when the outermost public call
+	// returns one LevelDelta per queued level goes to the ring, so a sweep yields one delta per level, not per fill
+	struct PendingDelta
+	{
+		Side side_;
+		Price price_;
+		bool existed_; // the level had orders before the command, if not and it ends empty nobody ever saw it
+	};
+	class DeltaScope // open in every public call that changes the book, the outermost one flushes
+	{
+	public:
+		explicit DeltaScope(OrderbookCore &core) : core_{core} { ++core_.deltaScopeDepth_; }
+		~DeltaScope()
+		{
+			if (--core_.deltaScopeDepth_ == 0 && !core_.pendingDeltas_.empty())
+			{
+				core_.FlushDeltas();
+			}
+		}
+
+	private:
+		OrderbookCore &core_;
+	};
+	std::unique_ptr<SpscRing<LevelDelta>> deltas_; // null unless OrderbookConfig::deltaRingCapacity_ is set
+	std::vector<PendingDelta> pendingDeltas_;
+	std::uint64_t deltaSequence_{0};
+	std::size_t deltaScopeDepth_{0};
+	void FlushDeltas();
+
+	// execution reports: a sweep writes both sides of each fill straight to the ring as it trades, from what it holds
+	// already, so the owner of an order follows it without reading the book; whatever leaves an order without trading
+	// follows as a cancel, so every order's last report is done_
+	std::unique_ptr<SpscRing<ExecutionReport>> reports_; // null unless OrderbookConfig::executionReportCapacity_ is set
+	std::uint64_t reportSequence_{0};
+	std::uint64_t execSequence_{0};
+	void Report(const ExecutionReport &report)
+	{
+		ExecutionReport numbered = report;
+		numbered.sequence_ = ++reportSequence_;
+		reports_->TryPush(numbered); // dropped on a full ring, the sequence number still moved on
+	}
+	void ReportCancel(const RestingOrder *order, Quantity cancelled); // before the book takes cancelled off it
+	template <typename O>
+	void ReportDropped(const O &order, std::span<const Trade> fills, Quantity leaves); // an aggressor's, after its sweep
+
+	ORDERBOOK_STATS_ONLY(OrderbookStats stats_;) // counters and histograms, only with ORDERBOOK_STATS
+
+	std::optional<Price> marketCollar_; // see OrderbookConfig::marketCollar_
+	Journal *journal_;					// null unless journaling, see OrderbookConfig::journal_
+	void Record(const JournalRecord &record)
+	{
+		if (journal_)
+		{
+			journal_->Append(record);
+		}
+	}
+
+	void Unindex(RestingOrder *order);		// take an order out of orders_, and out of the expiry index if it is in it
+	void ReleaseOrder(RestingOrder *order); // forget an order that already left its level
+	void Refill(RestingOrder *order, OrderDetails &details); // a filled iceberg shows its next slice, the caller requeues it
+
+	// lazy cancel (OrderbookConfig::lazyCancel_): a cancel only unindexes its order, settles the level totals and
+	// leaves the order linked as a tombstone (RestingOrder::Kill); a sweep releases the tombstones it meets at the front,
+	// CompactLevels the rest; a level whose last live order goes is dropped with its tombstones at once, so every level
+	// the book shows still has a live order and the depth, the touch and the matching never see a tombstone
+	struct TombstonedLevel
+	{
+		Side side_;
+		Price price_;
+	};
+	const bool lazyCancel_;
+	const std::size_t selfTradePrevention_; // OrderbookConfig::selfTradePrevention_, the row of Dispatch's table
+	std::size_t tombstones_{0};
+	std::vector<TombstonedLevel> tombstonedLevels_; // a level is queued with its first tombstone, stale entries are skipped
+	template <Side S>
+	void DropTombstones(PriceLevel &level, Price price); // the level holds tombstones only, release them and drop it
+	template <Side S>
+	bool CompactLevel(Price price, std::size_t maxOrders, std::size_t &released); // true once the level holds no tombstone
+
+	// the level data lives next to the orders of each level (see PriceLevel), callers hand in the level with its
+	// price and, at compile time, its side, so a fill never has to look at the order's details
+	template <Side S>
+	void OnOrderCancelled(PriceLevel &level, Price price, Quantity remaining);
+	template <Side S>
+	void OnOrderAdded(PriceLevel &level, Price price, Quantity remaining);
+	template <Side S>
+	void OnOrderMatched(PriceLevel &level, Price price, Quantity quantity, bool filled);
+	template <Side S>
+	void OnOrderAmended(PriceLevel &level, Price price, Quantity reduction);
+	template <Side S>
+	void UpdateLevelData(PriceLevel &level, Price price, Quantity quantity, LevelData::Action action);
+
+	// every side-dependent routine is written once and specialised at compile time on the side it acts for,
+	// a runtime side picks its specialisation once through BySide, never inside a loop
+	template <Side S>
+	using SideConstant = std::integral_constant<Side, S>;
+	static constexpr Side Opposite(Side side) { return side == Side::Buy ? Side::Sell : Side::Buy; }
+	template <Side S>
+	auto &SideLevels()
+	{
+		if constexpr (S == Side::Buy)
+		{
+			return bids_;
+		}
+		else
+		{
+			return asks_;
+		}
+	}
+	template <Side S>
+	const auto &SideLevels() const
+	{
+		if constexpr (S == Side::Buy)
+		{
+			return bids_;
+		}
+		else
+		{
+			return asks_;
+		}
+	}
+	template <typename Fn>
+	static decltype(auto) BySide(Side side, Fn &&fn) // fn(SideConstant<S>) for the side at hand
+	{
+		return side == Side::Buy ? fn(SideConstant<Side::Buy>{}) : fn(SideConstant<Side::Sell>{});
+	}
+
+	// AddOrder dispatches to one of these per side, order type and self-trade prevention mode (see its table), market orders never rest:
+	// they walk the opposite side from its best level and whatever is left is dropped
+	// an iceberg rests like a good till cancel order showing one slice at a time (OrderDetails::peak_), the levels and
+	// their totals only ever hold the slices on show, so the depth and fill or kill checks see the displayed quantity only
+	// the add path takes the order as any type with the getters of Order: an Order, or an OrderEntry::AddMessage read in
+	// place from a packet, each compiled on its own, so a wire order reaches the pool without being copied on the way
+	template <Side S, OrderType Type, SelfTradePrevention Stp, typename O>
+	bool Add(const O &order, Trades &trades);
+	template <Side S>
+	bool CanFullyFill(Price price, Quantity quantity) const;
+	// the same for an aggressor with an owner, under self-trade prevention: its own orders never fill it, cancel oldest
+	// passes over them and the other modes stop the sweep at the first one, so the walk goes order by order
+	template <Side S, SelfTradePrevention Stp>
+	bool CanFullyFill(Price price, Quantity quantity, OwnerId owner) const;
+	template <Side S>
+	bool CanMatch(Price price) const; // check if the order can be matched (for FillAndKill and ImmediateOrCancel orders)
+	// trade an incoming order against the opposite side, best level first, up to limit
+	// appends every fill to trades and returns the quantity left over, the order itself is never in the book
+	// Stp is the book's mode, fixed at construction: only a sweep compiled with prevention compares owners, one
+	// without carries no trace of it; a self-trade cancels or decrements orders instead of printing, and a
+	// cancel-newest aggressor is left with nothing, so it never rests
+	template <Side S, OrderType Type, SelfTradePrevention Stp, typename O>
+	Quantity Sweep(const O &order, Price limit, Trades &trades);
+	template <Side S>
+	void Rest(RestingOrder *order, Price price, ExpiryTime expiry); // a pooled order joins its level, orders_ and (unless max) the expiry index
+	template <Side S>
+	void Cancel(RestingOrder *order);
+	template <Side S>
+	void FillResting(RestingOrder *order, Quantity quantity); // a journaled fill, the order leaves the book once filled
+	template <Side S>
+	void Amend(RestingOrder *order, Quantity remaining);
+	template <Side S>
+	auto &SideStops()
+	{
+		if constexpr (S == Side::Buy)
+		{
+			return buyStops_;
+		}
+		else
+		{
+			return sellStops_;
+		}
+	}
+	template <Side S, typename O>
+	bool AddStop(const O &order);
+	template <Side S>
+	void Arm(RestingOrder *order); // a pooled stop joins its side's stop index and orders_, and the expiry index when it expires
+	template <typename O>
+	bool Dispatch(const O &order, Trades &trades); // AddOrder without its stats and without releasing stops
+	template <typename O>
+	bool Admit(const O &order, Trades &trades); // AddOrder for either kind of order
+	template <typename M>
+	bool Modify(const M &order, Trades &trades); // ModifyOrder for an OrderModify or an OrderEntry::ModifyMessage
+	// after a command has traded: every stop its last trade reached is taken out of the stop index, all of them in one
+	// batch in trigger order, and each is then matched as the order it turns into, within the same command; their trades
+	// may reach further stops, the cascade runs until the last trade price triggers nothing more
+	void ReleaseStops(Trades &trades);
+	bool AnyStopTriggered() const
+	{
+		return lastTradePrice_ && (buyStops_.AnyTriggered(*lastTradePrice_) || sellStops_.AnyTriggered(*lastTradePrice_));
+	}
+
+public:
+	explicit OrderbookCore(const OrderbookConfig &config = {});
+	// the pool and the levels hand out raw pointers into each other, a copied or moved core would dangle
+	OrderbookCore(const OrderbookCore &) = delete;
+	void operator=(const OrderbookCore &) = delete;
+	OrderbookCore(OrderbookCore &&) = delete;
+	void operator=(OrderbookCore &&) = delete;
+
+	// each command returns whether it was applied, fills are appended to trades
+	bool AddOrder(const Order &order, Trades &trades); // the order is copied into the book's pool, no allocation within capacity
+	bool CancelOrder(OrderId orderId);
+	// a reduce-only amend at the same price and side updates the order in place and keeps its queue position,
+	// anything else is a cancel and a re-add with the type of the resting order (back of the queue)
+	bool ModifyOrder(OrderModify order, Trades &trades);
+	// the same, straight from an order-entry packet (see OrderEntry::Reader), nothing is built on the way
+	bool AddOrder(const OrderEntry::AddMessage &order, Trades &trades);
+	bool ModifyOrder(const OrderEntry::ModifyMessage &order, Trades &trades);
+	void CancelOrders(const OrderIds &orderIds);
+	bool Apply(const Command &command, Trades &trades); // dispatch a queued command to the call above
+	// apply a batch in sequence, appending one result per command and every fill to the one trades stream
+	void Apply(std::span<const Command> commands, CommandResults &results, Trades &trades);
+	// read one order-entry packet and apply each valid message as it is read, appending one result per message
+	// returns how many messages it applied or rejected; loss and malformed messages are counted by the reader
+	std::size_t Apply(std::span<const std::byte> packet, OrderEntry::Reader &reader, CommandResults &results, Trades &trades);
+
+	// apply one journaled change as the book recorded it: an add rests as it was left, without checks or matching,
+	// and a fill reduces whichever of its orders rest, so replay costs no more than inserting the surviving orders
+	// false if the record does not fit the book (an unknown or duplicate order), nothing is journaled while restoring
+	bool Restore(const JournalRecord &record);
+
+	// the resting orders side by side (bids, then asks), level by level from best to worst, each level in queue order
+	template <typename Fn>
+	void ForEachRestingOrder(Fn &&fn) const
+	{
+		auto visit = [this, &fn](Price, const PriceLevel &level)
+		{
+			for (const RestingOrder &order : level.orders_)
+			{
+				if (!order.IsFilled()) // not a tombstone
+				{
+					fn(pool_.ToOrder(&order));
+				}
+			}
+			return true;
+		};
+		bids_.ForEachLevel(visit);
+		asks_.ForEachLevel(visit);
+	}
+	// the stop orders waiting for their trigger, buy stops then sell stops, each side in trigger order
+	template <typename Fn>
+	void ForEachStopOrder(Fn &&fn) const
+	{
+		auto visit = [this, &fn](const RestingOrder &order)
+		{ fn(pool_.ToOrder(&order)); };
+		buyStops_.ForEach(visit);
+		sellStops_.ForEach(visit);
+	}
+	// rest an order, partly filled to remaining, behind the worst level of its side without checks or matching
+	// for loading a saved book in ForEachRestingOrder order (then the stops in ForEachStopOrder order, untouched, they
+	// join the back of their trigger price), false if it is a duplicate or outside the ladder
+	bool LoadOrder(const Order &order, Quantity remaining);
+	// what LoadOrder checks, without touching the book: an order of a type that rests or waits, on the ladder, not a
+	// duplicate of one in the book, and with a remaining quantity it can have (SnapshotFile checks a whole file first)
+	bool CanLoadOrder(const Order &order, Quantity remaining) const;
+	std::optional<Price> LastTradePrice() const { return lastTradePrice_; }
+	void LoadLastTradePrice(std::optional<Price> price) { lastTradePrice_ = price; } // with a saved book, nothing is triggered
+	std::uint64_t JournalPosition() const { return journal_ ? journal_->Position() : 0; } // see Journal::Position
+
+	// cancel at most maxOrders of the orders whose expiry is at or before now, returns how many it cancelled
+	// call again while it returns maxOrders, so a large expiry never holds the book for long
+	std::size_t ExpireOrders(ExpiryTime now, std::size_t maxOrders);
+	std::optional<ExpiryTime> NextExpiry() const; // the earliest expiry in the book, if any order expires
+	// the close of the market (4 pm local time) that good for day orders resting at `now` expire at
+	static ExpiryTime NextGoodForDayExpiry(ExpiryTime now);
+
+	// release at most maxOrders of the tombstones lazy cancels left in the levels, returns how many it released
+	// the book looks the same before and after, so the owning thread calls it whenever it has nothing better to do
+	// call again while it returns maxOrders; without OrderbookConfig::lazyCancel_ there is never anything to do
+	std::size_t CompactLevels(std::size_t maxOrders);
+	std::size_t TombstoneCount() const { return tombstones_; }
+
+	std::size_t Size() const;
+	// depth reads the running totals of each level (LevelData), never the orders themselves
+	OrderbookLevelInfos GetOrderInfos() const;			 // every level of both sides
+	OrderbookLevelInfos GetTopN(std::size_t levels) const; // at most the best `levels` levels of each side
+	BestBidAsk GetBestBidAsk() const;
+	BookSnapshot GetSnapshot() const; // the best BookSnapshot::Depth levels, its version_ is left to the publisher
+	OrderbookStats GetStats() const;  // a copy of the counters and histograms so far, with the gauges as of now
+
+	// the next level change, from the one publisher thread; false when none is queued or deltas are off
+	// a full ring drops deltas rather than stall matching, a gap in sequence_ tells the consumer to resync from a snapshot
+	bool TryPollDelta(LevelDelta &delta) { return deltas_ && deltas_->TryPop(delta); }
+	// the next execution report, from one gateway thread that splits the stream by owner_; false when none is queued or
+	// reports are off; replaying a journal reports nothing, and as with deltas a gap in sequence_ means reports were dropped
+	bool TryPollExecutionReport(ExecutionReport &report) { return reports_ && reports_->TryPop(report); }
+};
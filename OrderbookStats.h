@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "LatencyHistogram.h"
+
+// built-in instrumentation of a book: counters and latency histograms of the hot paths
+// compiled in with ORDERBOOK_STATS defined (make STATS=1); without it every ORDERBOOK_STATS_ONLY statement
+// vanishes, the book keeps no counters at all and GetStats only fills in the gauges
+#if defined(ORDERBOOK_STATS)
+#define ORDERBOOK_STATS_ONLY(...) __VA_ARGS__
+#else
+#define ORDERBOOK_STATS_ONLY(...)
+#endif
+
+// the timestamp the histograms are kept in: the time stamp counter on x86 (cycles, a few ns to read),
+// steady_clock nanoseconds elsewhere
+inline std::uint64_t ReadTicks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// records the ticks between its construction and its destruction
+class ScopedTicks
+{
+public:
+	explicit ScopedTicks(LatencyHistogram &histogram) : histogram_{histogram}, start_{ReadTicks()} {}
+	ScopedTicks(const ScopedTicks &) = delete;
+	void operator=(const ScopedTicks &) = delete;
+	~ScopedTicks() { histogram_.Record(ReadTicks() - start_); }
+
+private:
+	LatencyHistogram &histogram_;
+	const std::uint64_t start_;
+};
+
+struct OrderbookStats
+{
+	bool enabled_{false}; // false when compiled without ORDERBOOK_STATS, only the gauges are filled in then
+
+	// counters, since the book was created
+	std::uint64_t adds_{0};				 // accepted adds, including the re-add of a modify
+	std::uint64_t addRejects_{0};		 // duplicates, prices off the ladder, immediate orders that could not trade
+	std::uint64_t fillOrKillRejects_{0}; // fill or kill orders the book could not fill whole (also counted in addRejects_)
+	std::uint64_t cancels_{0};			 // orders cancelled, by a client or an expiry
+	std::uint64_t modifies_{0};			 // modifies of a resting order
+	std::uint64_t fills_{0};			 // trades
+	std::uint64_t expired_{0};			 // orders cancelled at their expiry
+	std::uint64_t stopsTriggered_{0};	 // stop orders released by a trade
+	std::uint64_t stopsDropped_{0};		 // released stops the book refused, a market order with nothing to trade against
+	std::uint64_t pruneSweeps_{0};		 // expiry chunks run by the prune thread (Orderbook only)
+	std::uint64_t preTradeRejects_{0};	 // adds and modifies refused before the lock (Orderbook only, not in addRejects_)
+
+	// latency of each call, in ticks (see ReadTicks)
+	LatencyHistogram add_;
+	LatencyHistogram cancel_;
+	LatencyHistogram modify_;
+	LatencyHistogram match_;	// the sweep of an aggressor through the opposite side, part of add_
+	LatencyHistogram lockWait_; // waiting for the book's mutex (Orderbook only), an uncontended lock records 0
+
+	// gauges, read when GetStats is called
+	std::size_t orders_{0};
+	std::size_t bidLevels_{0};
+	std::size_t askLevels_{0};
+	std::size_t tombstones_{0}; // lazily cancelled orders still linked in their levels (OrderbookConfig::lazyCancel_)
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include "BookSnapshot.h"
+#include "Command.h"
+#include "Order.h"
+#include "OrderType.h"
+#include "OrderbookConfig.h"
+#include "Side.h"
+#include "Usings.h"
+
+// the checks an order can pass or fail before it reaches the book, so they run on the gateway threads rather than
+// under the book's lock or on its matching thread; every call is const and touches no shared state, any number of
+// threads may screen at once
+// - Validate: the shape of the order and the book's PreTradeLimits, no book state at all
+// - Screen: an immediate or market order against a published BookSnapshot, optimistic: it only rejects what the
+//   snapshot proves cannot trade, everything it passes is checked again by the book under its lock
+// Screen is only sound where the snapshot already holds every change the calling thread has made (Orderbook
+// publishes under its lock before returning); the engines publish after the fact, their gateways only Validate
+class PreTradeCheck
+{
+public:
+	enum class Result
+	{
+		Passed,
+		InvalidOrder,  // a quantity of zero, an unknown side or type, a price off the ladder, an iceberg showing nothing
+		LimitBreached, // quantity, notional or price outside PreTradeLimits
+		CannotMatch,   // a fill and kill, immediate or cancel or market order the book has nothing to trade against
+		CannotFill,	   // a fill or kill order the book cannot fill whole
+	};
+
+	PreTradeCheck(const PreTradeLimits &limits, const std::optional<LadderConfig> &ladder) : limits_{limits}, ladder_{ladder} {}
+
+	// any order with the getters of Order: an Order, or an OrderEntry::AddMessage still in its packet
+	template <typename O>
+	Result Validate(const O &order) const
+	{
+		if (order.GetInitialQuantity() == 0 || (order.GetSide() != Side::Buy && order.GetSide() != Side::Sell) ||
+			static_cast<std::size_t>(order.GetOrderType()) >= OrderTypeCount)
+		{
+			return Result::InvalidOrder;
+		}
+		if (order.GetOrderType() == OrderType::Iceberg && order.GetDisplayQuantity() == 0)
+		{
+			return Result::InvalidOrder;
+		}
+		if (order.GetInitialQuantity() > limits_.maxQuantity_)
+		{
+			return Result::LimitBreached;
+		}
+		if (IsStop(order.GetOrderType()) && (order.GetStopPrice() < limits_.minPrice_ || order.GetStopPrice() > limits_.maxPrice_))
+		{
+			return Result::LimitBreached;
+		}
+		if (order.GetOrderType() == OrderType::Market || order.GetOrderType() == OrderType::Stop) // no price of its own, the collar bounds it in the book
+		{
+			return Result::Passed;
+		}
+		if (ladder_ && !ladder_->Accepts(order.GetPrice()))
+		{
+			return Result::InvalidOrder;
+		}
+		if (order.GetPrice() < limits_.minPrice_ || order.GetPrice() > limits_.maxPrice_ ||
+			static_cast<std::int64_t>(order.GetPrice()) * order.GetInitialQuantity() > limits_.maxNotional_)
+		{
+			return Result::LimitBreached;
+		}
+		return Result::Passed;
+	}
+	// a command of a batch or a ring: adds as they are, a modify as the order it would re-add (its type is the resting
+	// order's, unknown here, the limits do not depend on it), a cancel always passes
+	Result Validate(const Command &command) const
+	{
+		switch (command.type_)
+		{
+		case Command::Type::Add:
+			return Validate(command.ToOrder());
+		case Command::Type::Modify:
+			return Validate(command.ToOrderModify().ToOrder(OrderType::GoodTillCancel, ExpiryTime::max()));
+		case Command::Type::Cancel:
+			break;
+		}
+		return Result::Passed;
+	}
+
+	// the same walk as OrderbookCore::CanMatch and CanFullyFill, over the snapshot's levels; the snapshot only holds
+	// the best BookSnapshot::Depth levels, so a fill or kill is only rejected when the levels past them cannot help
+	static Result Screen(const Order &order, const BookSnapshot &snapshot)
+	{
+		const OrderType type = order.GetOrderType();
+		const bool fillOrKill = type == OrderType::FillOrKill;
+		if (!fillOrKill && type != OrderType::FillAndKill && type != OrderType::ImmediateOrCancel && type != OrderType::Market)
+		{
+			return Result::Passed; // a resting type rests whatever it does not trade, a stop waits for its trigger
+		}
+		const bool buy = order.GetSide() == Side::Buy;
+		const auto &levels = buy ? snapshot.asks_ : snapshot.bids_;
+		const std::uint32_t count = buy ? snapshot.askCount_ : snapshot.bidCount_;
+		if (type == OrderType::Market)
+		{
+			return count ? Result::Passed : Result::CannotMatch;
+		}
+		auto isWithin = [&](Price price)
+		{ return buy ? price <= order.GetPrice() : price >= order.GetPrice(); };
+		if (!count || !isWithin(levels[0].price_))
+		{
+			return Result::CannotMatch;
+		}
+		if (!fillOrKill)
+		{
+			return Result::Passed;
+		}
+		Quantity quantity = order.GetInitialQuantity();
+		for (std::uint32_t level = 0; level < count; ++level)
+		{
+			if (!isWithin(levels[level].price_)) // this level and every level after it are worse than the order's price
+			{
+				return Result::CannotFill;
+			}
+			if (quantity <= levels[level].quantity_)
+			{
+				return Result::Passed;
+			}
+			quantity -= levels[level].quantity_;
+		}
+		// every level of the side is in the snapshot, or the ones past it may still be within the price
+		return count < BookSnapshot::Depth ? Result::CannotFill : Result::Passed;
+	}
+
+private:
+	PreTradeLimits limits_;
+	std::optional<LadderConfig> ladder_;
+};
@@ -0,0 +1,321 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory_resource>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "LevelData.h"
+#include "LevelScan.h"
+#include "OrderList.h"
+#include "OrderbookConfig.h"
+#include "Usings.h"
+
+// a price level: its FIFO of orders plus the running totals kept next to it, in price order
+struct PriceLevel
+{
+	OrderList orders_;
+	LevelData data_;
+};
+
+// one side of the book: price levels kept in priority order (best first)
+// Compare is std::greater<Price> for bids (descending) and std::less<Price> for asks (ascending)
+// two backends, picked once at construction:
+// - map: a std::map keyed by price, works for any price (unbounded instruments)
+// - ladder: a contiguous array indexed by (price - base) / tick, with the best index cached and
+//   an occupancy bitmap to jump to the next non-empty level without touching the empty ones, and every level's
+//   quantity mirrored in one contiguous array, so the long scans (LevelScan) run over plain vectors
+template <typename Compare>
+class PriceLevels
+{
+public:
+	PriceLevels(const std::optional<LadderConfig> &ladder, std::pmr::memory_resource *resource)
+		: map_{resource}
+	{
+		if (ladder)
+		{
+			basePrice_ = ladder->basePrice_;
+			tickSize_ = ladder->tickSize_;
+			levels_.resize(ladder->levelCount_);
+			quantities_.resize(ladder->levelCount_);
+			occupied_.resize((ladder->levelCount_ + BitsPerWord - 1) / BitsPerWord);
+		}
+	}
+
+	bool IsLadder() const { return !levels_.empty(); }
+	bool Accepts(Price price) const // a ladder only holds prices inside its band and on its tick grid
+	{
+		if (!IsLadder())
+		{
+			return true;
+		}
+		if (price < basePrice_ || (price - basePrice_) % tickSize_ != 0)
+		{
+			return false;
+		}
+		return ToIndex(price) < levels_.size();
+	}
+
+	static bool IsWithin(Price price, Price limit) { return !Compare{}(limit, price); } // a level at price is no worse than limit
+
+	std::size_t LevelCount() const // non-empty levels, counted on demand, not kept up to date on the hot path
+	{
+		if (!IsLadder())
+		{
+			return map_.size();
+		}
+		std::size_t count = 0;
+		for (const std::uint64_t word : occupied_)
+		{
+			count += static_cast<std::size_t>(std::popcount(word));
+		}
+		return count;
+	}
+	bool empty() const { return IsLadder() ? best_ == NoLevel : map_.empty(); }
+	Price BestPrice() const { return IsLadder() ? ToPrice(best_) : map_.begin()->first; }
+	PriceLevel &BestLevel() { return IsLadder() ? levels_[best_] : map_.begin()->second; }
+	const PriceLevel &BestLevel() const { return IsLadder() ? levels_[best_] : map_.begin()->second; }
+
+	PriceLevel &Level(Price price) // the level of a resting order, it must exist
+	{
+		return IsLadder() ? levels_[ToIndex(price)] : map_.find(price)->second;
+	}
+
+	void SyncQuantity(const PriceLevel &level) // after a change of level's data_, the book calls it for every change
+	{
+		if (IsLadder())
+		{
+			quantities_[static_cast<std::size_t>(&level - levels_.data())] = level.data_.quantity_;
+		}
+	}
+	// ladder only: the levels no worse than limit hold at least quantity between them, false when there are none
+	bool Reaches(Price limit, Quantity quantity) const
+	{
+		if (best_ == NoLevel || !IsWithin(ToPrice(best_), limit))
+		{
+			return false;
+		}
+		// every level from the best to the last one within the limit, the empty ones add nothing
+		std::size_t first = best_;
+		std::size_t last = best_;
+		const std::int64_t offset = static_cast<std::int64_t>(limit) - basePrice_; // limit is past the best level, never behind the base for asks
+		if constexpr (Descending)
+		{
+			first = offset <= 0 ? 0 : static_cast<std::size_t>((offset + tickSize_ - 1) / tickSize_);
+		}
+		else
+		{
+			last = std::min(static_cast<std::size_t>(offset / tickSize_), levels_.size() - 1);
+		}
+		return LevelScan::Reaches(quantities_.data() + first, last - first + 1, quantity);
+	}
+
+	PriceLevel *Find(Price price) // the level at a price the side has held, null when a map level is gone
+	{
+		if (IsLadder())
+		{
+			return &levels_[ToIndex(price)]; // a ladder level outlives its orders, it is just empty
+		}
+		auto it = map_.find(price);
+		return it == map_.end() ? nullptr : &it->second;
+	}
+
+	// the price is the order's own, a resting order does not carry it (see OrderDetails)
+	PriceLevel &Push(RestingOrder *order, Price price) // join the back of the order's price level, creating the level if needed
+	{
+		if (!IsLadder())
+		{
+			PriceLevel &level = map_[price];
+			level.orders_.push_back(order);
+			return level;
+		}
+		const std::size_t index = ToIndex(price);
+		PriceLevel &level = levels_[index];
+		if (level.orders_.empty())
+		{
+			occupied_[index / BitsPerWord] |= Bit(index);
+			if (best_ == NoLevel || IsBetter(index, best_))
+			{
+				best_ = index;
+			}
+		}
+		level.orders_.push_back(order);
+		return level;
+	}
+	// join the back of the worst level, for loading a side level by level from best to worst
+	// the map is hinted at its end, so a whole side builds in one pass without a search per level
+	PriceLevel &Append(RestingOrder *order, Price price)
+	{
+		if (IsLadder())
+		{
+			return Push(order, price);
+		}
+		auto last = map_.empty() ? map_.end() : std::prev(map_.end());
+		if (last == map_.end() || last->first != price)
+		{
+			last = map_.emplace_hint(map_.end(), price, PriceLevel{});
+		}
+		last->second.orders_.push_back(order);
+		return last->second;
+	}
+	void Remove(RestingOrder *order, Price price) // unlink from its level, dropping the level once it is empty
+	{
+		if (!IsLadder())
+		{
+			auto it = map_.find(price);
+			it->second.orders_.erase(order);
+			if (it->second.orders_.empty())
+			{
+				map_.erase(it);
+			}
+			return;
+		}
+		const std::size_t index = ToIndex(price);
+		levels_[index].orders_.erase(order);
+		if (levels_[index].orders_.empty())
+		{
+			ClearLevel(index);
+		}
+	}
+	template <typename Fn>
+	void Drop(Price price, Fn &&release) // unlink every order of a level front to back, handing each to release, and drop the level
+	{
+		PriceLevel &level = Level(price);
+		while (!level.orders_.empty())
+		{
+			RestingOrder *order = level.orders_.front();
+			level.orders_.pop_front();
+			release(order);
+		}
+		if (!IsLadder())
+		{
+			map_.erase(price);
+			return;
+		}
+		ClearLevel(ToIndex(price));
+	}
+	void PopBest() // drop the best order of the best level, and the level itself once it is empty
+	{
+		if (!IsLadder())
+		{
+			auto it = map_.begin();
+			it->second.orders_.pop_front();
+			if (it->second.orders_.empty())
+			{
+				map_.erase(it);
+			}
+			return;
+		}
+		levels_[best_].orders_.pop_front();
+		if (levels_[best_].orders_.empty())
+		{
+			ClearLevel(best_);
+		}
+	}
+
+	// visit the non-empty levels from best to worst, fn(price, level) returns false to stop early
+	template <typename Fn>
+	void ForEachLevel(Fn &&fn) const
+	{
+		if (!IsLadder())
+		{
+			for (const auto &[price, level] : map_)
+			{
+				if (!fn(price, level))
+				{
+					return;
+				}
+			}
+			return;
+		}
+		for (std::size_t index = best_; index != NoLevel; index = NextOccupied(index))
+		{
+			if (!fn(ToPrice(index), levels_[index]))
+			{
+				return;
+			}
+		}
+	}
+
+private:
+	static constexpr bool Descending = std::is_same_v<Compare, std::greater<Price>>; // bids walk down the ladder
+	static constexpr std::size_t BitsPerWord = 64;
+	static constexpr std::size_t NoLevel = std::numeric_limits<std::size_t>::max();
+
+	static std::uint64_t Bit(std::size_t index) { return std::uint64_t{1} << (index % BitsPerWord); }
+	static bool IsBetter(std::size_t index, std::size_t other) { return Descending ? index > other : index < other; }
+	std::size_t ToIndex(Price price) const { return static_cast<std::size_t>((price - basePrice_) / tickSize_); }
+	Price ToPrice(std::size_t index) const { return basePrice_ + static_cast<Price>(index) * tickSize_; }
+
+	void ClearLevel(std::size_t index)
+	{
+		occupied_[index / BitsPerWord] &= ~Bit(index);
+		if (index == best_)
+		{
+			best_ = NextOccupied(index);
+		}
+	}
+	// the next non-empty level worse than index, in priority order, one bitmap word at a time
+	std::size_t NextOccupied(std::size_t index) const
+	{
+		if constexpr (Descending)
+		{
+			if (index == 0)
+			{
+				return NoLevel;
+			}
+			--index;
+			std::size_t word = index / BitsPerWord;
+			std::uint64_t bits = occupied_[word] & (~std::uint64_t{0} >> (BitsPerWord - 1 - index % BitsPerWord)); // bits at or below index
+			if (!bits) // the rest of the gap a vector scan at a time
+			{
+				const std::size_t next = LevelScan::LastNonZero(occupied_.data(), word);
+				if (next == word)
+				{
+					return NoLevel;
+				}
+				word = next;
+				bits = occupied_[word];
+			}
+			return word * BitsPerWord + (BitsPerWord - 1 - std::countl_zero(bits));
+		}
+		else
+		{
+			++index;
+			if (index >= levels_.size())
+			{
+				return NoLevel;
+			}
+			std::size_t word = index / BitsPerWord;
+			std::uint64_t bits = occupied_[word] & (~std::uint64_t{0} << (index % BitsPerWord)); // bits at or above index
+			if (!bits)
+			{
+				word += 1 + LevelScan::FirstNonZero(occupied_.data() + word + 1, occupied_.size() - word - 1);
+				if (word == occupied_.size())
+				{
+					return NoLevel;
+				}
+				bits = occupied_[word];
+			}
+			return word * BitsPerWord + std::countr_zero(bits);
+		}
+	}
+
+	// map backend
+	std::pmr::map<Price, PriceLevel, Compare> map_;
+
+	// ladder backend
+	Price basePrice_{};
+	Price tickSize_{1};
+	std::vector<PriceLevel> levels_;
+	std::vector<Quantity> quantities_;	  // levels_[i].data_.quantity_, kept in step by SyncQuantity
+	std::vector<std::uint64_t> occupied_; // one bit per level, set while the level has orders
+	std::size_t best_{NoLevel};
+};
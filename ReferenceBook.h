@@ -0,0 +1,491 @@
+#pragma once
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <map>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "Command.h"
+#include "LevelInfo.h"
+#include "Order.h"
+#include "OrderModify.h"
+#include "OrderType.h"
+#include "OrderbookConfig.h"
+#include "OrderbookCore.h"
+#include "SelfTradePrevention.h"
+#include "Side.h"
+#include "Trade.h"
+#include "Usings.h"
+
+// the book's matching rules written out the plain way, for the replay tool to check OrderbookCore against
+// (orderbook_replay fuzz): lists of orders in std::maps of prices, linear searches, nothing pooled, indexed or specialised
+// it follows OrderbookCore command for command under the same OrderbookConfig: the ladder's band and tick grid, the
+// market collar, self-trade prevention and expiry (ExpireOrders, called with the same times as the core's); the rest of
+// the config only changes how the core stores the book, never what it does
+// a good for day order expires at the close OrderbookCore::NextGoodForDayExpiry names, the calendar is not a matching rule
+class ReferenceBook
+{
+public:
+	explicit ReferenceBook(const OrderbookConfig &config = {})
+		: ladder_{config.ladder_}, marketCollar_{config.marketCollar_}, selfTradePrevention_{config.selfTradePrevention_} {}
+
+	bool Apply(const Command &command, Trades &trades)
+	{
+		switch (command.type_)
+		{
+		case Command::Type::Add:
+			return AddOrder(command.ToOrder(), trades);
+		case Command::Type::Cancel:
+			return CancelOrder(command.orderId_);
+		case Command::Type::Modify:
+			return ModifyOrder(command.ToOrderModify(), trades);
+		}
+		return false;
+	}
+
+	bool AddOrder(const Order &order, Trades &trades)
+	{
+		const bool added = Dispatch(order, trades);
+		if (added)
+		{
+			ReleaseStops(trades);
+		}
+		return added;
+	}
+
+	bool CancelOrder(OrderId orderId)
+	{
+		const auto found = where_.find(orderId);
+		if (found == where_.end())
+		{
+			return false;
+		}
+		const auto [side, price, stop] = found->second;
+		Queues &queues = stop ? Stops(side) : Levels(side);
+		auto &queue = queues[price];
+		queue.erase(std::find_if(queue.begin(), queue.end(), [orderId](const Entry &entry)
+								 { return entry.orderId_ == orderId; }));
+		if (queue.empty())
+		{
+			queues.erase(price);
+		}
+		where_.erase(found);
+		return true;
+	}
+
+	bool ModifyOrder(OrderModify order, Trades &trades)
+	{
+		Entry *existing = Find(order.GetOrderID());
+		if (!existing)
+		{
+			return false;
+		}
+		if (!IsStop(existing->type_) && order.GetSide() == existing->side_ && order.GetPrice() == existing->price_ &&
+			order.GetQuantity() > 0 && order.GetQuantity() <= existing->visible_ + existing->reserve_)
+		{
+			// reduce in place, the hidden reserve goes first
+			const Quantity reduction = existing->visible_ + existing->reserve_ - order.GetQuantity();
+			const Quantity hidden = std::min(reduction, existing->reserve_);
+			existing->reserve_ -= hidden;
+			existing->visible_ -= reduction - hidden;
+			existing->initial_ -= reduction;
+			return true;
+		}
+		Order replacement{existing->type_, order.GetOrderID(), order.GetSide(), order.GetPrice(), order.GetQuantity(),
+						  existing->expiry_, existing->peak_, existing->stopPrice_, existing->owner_};
+		CancelOrder(order.GetOrderID());
+		return AddOrder(replacement, trades);
+	}
+
+	// every order whose expiry is at or before now, resting or waiting, is cancelled; returns how many
+	std::size_t ExpireOrders(ExpiryTime now)
+	{
+		std::vector<OrderId> due;
+		for (const Queues *queues : {&bids_, &asks_, &buyStops_, &sellStops_})
+		{
+			for (const auto &[_, queue] : *queues)
+			{
+				for (const Entry &entry : queue)
+				{
+					if (entry.expiry_ <= now)
+					{
+						due.push_back(entry.orderId_);
+					}
+				}
+			}
+		}
+		for (const OrderId orderId : due)
+		{
+			CancelOrder(orderId);
+		}
+		return due.size();
+	}
+	std::optional<ExpiryTime> NextExpiry() const
+	{
+		std::optional<ExpiryTime> next;
+		for (const Queues *queues : {&bids_, &asks_, &buyStops_, &sellStops_})
+		{
+			for (const auto &[_, queue] : *queues)
+			{
+				for (const Entry &entry : queue)
+				{
+					if (entry.expiry_ != ExpiryTime::max() && (!next || entry.expiry_ < *next))
+					{
+						next = entry.expiry_;
+					}
+				}
+			}
+		}
+		return next;
+	}
+	std::optional<Price> LastTradePrice() const { return lastTradePrice_; }
+
+	std::size_t Size() const { return where_.size(); }
+	// fn(orderId, side, price, remaining): the bids then the asks, best level first, each in queue order
+	template <typename Fn>
+	void ForEachRestingOrder(Fn &&fn) const
+	{
+		for (auto level = bids_.rbegin(); level != bids_.rend(); ++level)
+		{
+			Visit(level->second, fn);
+		}
+		for (const auto &[_, queue] : asks_)
+		{
+			Visit(queue, fn);
+		}
+	}
+	// the same for the waiting stops: buy stops lowest first, then sell stops highest first
+	template <typename Fn>
+	void ForEachStopOrder(Fn &&fn) const
+	{
+		for (const auto &[_, queue] : buyStops_)
+		{
+			Visit(queue, fn);
+		}
+		for (auto bucket = sellStops_.rbegin(); bucket != sellStops_.rend(); ++bucket)
+		{
+			Visit(bucket->second, fn);
+		}
+	}
+	LevelInfos Depth(Side side) const // every level of a side, best first, with the quantity on show
+	{
+		LevelInfos infos;
+		auto collect = [&infos](const auto &level)
+		{
+			Quantity quantity = 0;
+			for (const Entry &entry : level.second)
+			{
+				quantity += entry.visible_;
+			}
+			infos.push_back(LevelInfo{level.first, quantity});
+		};
+		if (side == Side::Buy)
+		{
+			std::for_each(bids_.rbegin(), bids_.rend(), collect);
+		}
+		else
+		{
+			std::for_each(asks_.begin(), asks_.end(), collect);
+		}
+		return infos;
+	}
+
+private:
+	struct Entry
+	{
+		OrderId orderId_;
+		OrderType type_;
+		Side side_;
+		Price price_;
+		Quantity initial_;
+		Quantity visible_; // what the level shows
+		Quantity reserve_; // an iceberg's hidden rest
+		Quantity peak_;	   // an iceberg's display quantity, 0 for the other types
+		Price stopPrice_;
+		OwnerId owner_;
+		ExpiryTime expiry_;
+	};
+	using Queues = std::map<Price, std::list<Entry>>; // ascending whatever the side, each side walks it its own way
+	struct Location
+	{
+		Side side_;
+		Price price_;
+		bool stop_; // in a stop bucket rather than a level
+	};
+
+	Queues &Levels(Side side) { return side == Side::Buy ? bids_ : asks_; }
+	Queues &Stops(Side side) { return side == Side::Buy ? buyStops_ : sellStops_; }
+	static Side Opposite(Side side) { return side == Side::Buy ? Side::Sell : Side::Buy; }
+	// the best level of the side levels belong to, which must not be empty
+	static Queues::iterator Best(Queues &levels, Side side) { return side == Side::Buy ? std::prev(levels.end()) : levels.begin(); }
+	// a buy reaches the asks at or below its limit, a sell the bids at or above it
+	static bool Reaches(Side side, Price price, Price limit) { return side == Side::Buy ? price <= limit : price >= limit; }
+	bool Accepts(Price price) const { return !ladder_ || ladder_->Accepts(price); }
+	// an aggressor with an owner never trades with that owner's orders under self-trade prevention
+	bool SelfTrade(const Order &order, const Entry &resting) const
+	{
+		return selfTradePrevention_ != SelfTradePrevention::None && order.GetOwner() && order.GetOwner() == resting.owner_;
+	}
+
+	Entry *Find(OrderId orderId)
+	{
+		const auto found = where_.find(orderId);
+		if (found == where_.end())
+		{
+			return nullptr;
+		}
+		const auto [side, price, stop] = found->second;
+		auto &queue = (stop ? Stops(side) : Levels(side))[price];
+		return &*std::find_if(queue.begin(), queue.end(), [orderId](const Entry &entry)
+							  { return entry.orderId_ == orderId; });
+	}
+	template <typename Fn>
+	static void Visit(const std::list<Entry> &queue, Fn &fn)
+	{
+		for (const Entry &entry : queue)
+		{
+			fn(entry.orderId_, entry.side_, entry.price_, entry.visible_ + entry.reserve_);
+		}
+	}
+
+	bool Dispatch(const Order &order, Trades &trades)
+	{
+		if (where_.contains(order.GetOrderID()))
+		{
+			return false;
+		}
+		const OrderType type = order.GetOrderType();
+		const Side side = order.GetSide();
+		Queues &opposite = Levels(Opposite(side));
+		if (IsStop(type))
+		{
+			if (type == OrderType::StopLimit && !Accepts(order.GetPrice()))
+			{
+				return false;
+			}
+			Stops(side)[order.GetStopPrice()].push_back(MakeEntry(order, order.GetInitialQuantity(), order.GetInitialQuantity(), 0, order.GetExpiry()));
+			where_[order.GetOrderID()] = Location{side, order.GetStopPrice(), true};
+			return true;
+		}
+		if (type == OrderType::Market)
+		{
+			if (opposite.empty())
+			{
+				return false;
+			}
+			Price limit = side == Side::Buy ? std::numeric_limits<Price>::max() : std::numeric_limits<Price>::min();
+			if (marketCollar_) // from the touch at arrival, no further than the edge of the price range
+			{
+				const std::int64_t reach = std::int64_t{Best(opposite, Opposite(side))->first} + (side == Side::Buy ? *marketCollar_ : -*marketCollar_);
+				limit = static_cast<Price>(std::clamp<std::int64_t>(reach, std::numeric_limits<Price>::min(), std::numeric_limits<Price>::max()));
+			}
+			Sweep(order, limit, trades);
+			return true;
+		}
+		if (!Accepts(order.GetPrice()))
+		{
+			return false;
+		}
+		const bool immediate = type == OrderType::FillAndKill || type == OrderType::ImmediateOrCancel || type == OrderType::FillOrKill;
+		const bool crosses = !opposite.empty() && Reaches(side, Best(opposite, Opposite(side))->first, order.GetPrice());
+		if (immediate && !crosses)
+		{
+			return false;
+		}
+		if (type == OrderType::FillOrKill && !CanFullyFill(order))
+		{
+			return false;
+		}
+		if (type == OrderType::Iceberg && order.GetDisplayQuantity() == 0)
+		{
+			return false;
+		}
+		const std::size_t firstTrade = trades.size();
+		const Quantity remaining = crosses ? Sweep(order, order.GetPrice(), trades) : order.GetInitialQuantity();
+		if (immediate || remaining == 0)
+		{
+			return true;
+		}
+		// an iceberg shows what is left of its current peak-sized slice, counted from its first traded unit; what
+		// self-trade prevention took never traded, the order rests as if it had come in without it
+		Quantity filled = 0;
+		for (const Trade &trade : std::span{trades}.subspan(firstTrade))
+		{
+			filled += trade.GetBidTrade().quantity_;
+		}
+		const Quantity peak = type == OrderType::Iceberg ? order.GetDisplayQuantity() : Quantity{};
+		const Quantity visible = peak ? std::min(remaining, peak - filled % peak) : remaining;
+		const ExpiryTime expiry = type == OrderType::GoodForDay ? OrderbookCore::NextGoodForDayExpiry(std::chrono::system_clock::now()) : order.GetExpiry();
+		Levels(side)[order.GetPrice()].push_back(MakeEntry(order, filled + remaining, visible, remaining - visible, expiry));
+		where_[order.GetOrderID()] = Location{side, order.GetPrice(), false};
+		return true;
+	}
+	static Entry MakeEntry(const Order &order, Quantity initial, Quantity visible, Quantity reserve, ExpiryTime expiry)
+	{
+		return Entry{order.GetOrderID(), order.GetOrderType(), order.GetSide(), order.GetPrice(), initial, visible, reserve,
+					 order.GetOrderType() == OrderType::Iceberg ? order.GetDisplayQuantity() : Quantity{}, order.GetStopPrice(), order.GetOwner(), expiry};
+	}
+
+	// order by order, as the sweep would meet them: cancel oldest passes over the owner's own orders, every other
+	// mode would stop the sweep at the first one
+	bool CanFullyFill(const Order &order)
+	{
+		const Side side = order.GetSide();
+		Quantity quantity = order.GetInitialQuantity();
+		auto walk = [&](auto level, auto end) // best first
+		{
+			for (; level != end && Reaches(side, level->first, order.GetPrice()); ++level)
+			{
+				for (const Entry &resting : level->second)
+				{
+					if (SelfTrade(order, resting))
+					{
+						if (selfTradePrevention_ == SelfTradePrevention::CancelOldest)
+						{
+							continue;
+						}
+						return false;
+					}
+					if (quantity <= resting.visible_)
+					{
+						return true;
+					}
+					quantity -= resting.visible_;
+				}
+			}
+			return false;
+		};
+		Queues &opposite = Levels(Opposite(side));
+		return side == Side::Buy ? walk(opposite.begin(), opposite.end()) : walk(opposite.rbegin(), opposite.rend());
+	}
+
+	Quantity Sweep(const Order &order, Price limit, Trades &trades)
+	{
+		const Side side = order.GetSide();
+		Queues &opposite = Levels(Opposite(side));
+		Quantity remaining = order.GetInitialQuantity();
+		while (remaining && !opposite.empty())
+		{
+			const auto level = Best(opposite, Opposite(side));
+			const Price price = level->first;
+			if (!Reaches(side, price, limit))
+			{
+				break;
+			}
+			auto &queue = level->second;
+			while (remaining && !queue.empty())
+			{
+				Entry &resting = queue.front();
+				if (SelfTrade(order, resting))
+				{
+					if (selfTradePrevention_ == SelfTradePrevention::CancelNewest) // the aggressor goes, whatever is left of it
+					{
+						remaining = 0;
+						break;
+					}
+					// cancel oldest takes the resting order out whole, decrement both the smaller quantity off each
+					const Quantity restingRemaining = resting.visible_ + resting.reserve_;
+					const Quantity decrement = selfTradePrevention_ == SelfTradePrevention::CancelOldest ? restingRemaining : std::min(remaining, restingRemaining);
+					if (selfTradePrevention_ == SelfTradePrevention::DecrementBoth)
+					{
+						remaining -= decrement;
+					}
+					if (decrement < restingRemaining) // reduced where it rests, the hidden reserve goes first
+					{
+						const Quantity hidden = std::min(decrement, resting.reserve_);
+						resting.reserve_ -= hidden;
+						resting.visible_ -= decrement - hidden;
+						resting.initial_ -= decrement;
+						continue;
+					}
+					where_.erase(resting.orderId_);
+					queue.pop_front();
+					continue;
+				}
+				const Quantity quantity = std::min(remaining, resting.visible_);
+				resting.visible_ -= quantity;
+				remaining -= quantity;
+				lastTradePrice_ = price;
+				const TradeInfo taker{order.GetOrderID(), order.GetOrderType() == OrderType::Market ? price : order.GetPrice(), quantity};
+				const TradeInfo maker{resting.orderId_, price, quantity};
+				trades.push_back(side == Side::Buy ? Trade{taker, maker} : Trade{maker, taker});
+				if (resting.visible_)
+				{
+					continue;
+				}
+				if (resting.reserve_) // the next slice goes to the back of the level
+				{
+					resting.visible_ = std::min(resting.peak_, resting.reserve_);
+					resting.reserve_ -= resting.visible_;
+					queue.splice(queue.end(), queue, queue.begin());
+					continue;
+				}
+				where_.erase(resting.orderId_);
+				queue.pop_front();
+			}
+			if (queue.empty())
+			{
+				opposite.erase(level);
+			}
+		}
+		return remaining;
+	}
+
+	// every stop the last trade price reaches, buys then sells, each side in trigger order, is matched as the order it
+	// turns into; their trades may reach further stops, until the price triggers nothing more
+	void ReleaseStops(Trades &trades)
+	{
+		std::vector<Order> triggered;
+		while (lastTradePrice_)
+		{
+			const Price price = *lastTradePrice_;
+			auto release = [&](std::list<Entry> &queue)
+			{
+				for (const Entry &stop : queue)
+				{
+					// a stop limit rests till the expiry it carried, if it carried one
+					Order order = stop.type_ == OrderType::Stop			  ? Order{stop.orderId_, stop.side_, stop.initial_}
+								  : stop.expiry_ != ExpiryTime::max() ? Order{OrderType::GoodTillDate, stop.orderId_, stop.side_, stop.price_, stop.initial_, stop.expiry_}
+																	  : Order{OrderType::GoodTillCancel, stop.orderId_, stop.side_, stop.price_, stop.initial_};
+					order.SetOwner(stop.owner_);
+					triggered.push_back(order);
+					where_.erase(stop.orderId_);
+				}
+			};
+			while (!buyStops_.empty() && buyStops_.begin()->first <= price)
+			{
+				release(buyStops_.begin()->second);
+				buyStops_.erase(buyStops_.begin());
+			}
+			while (!sellStops_.empty() && std::prev(sellStops_.end())->first >= price)
+			{
+				release(std::prev(sellStops_.end())->second);
+				sellStops_.erase(std::prev(sellStops_.end()));
+			}
+			if (triggered.empty())
+			{
+				return;
+			}
+			for (const Order &order : triggered)
+			{
+				Dispatch(order, trades);
+			}
+			triggered.clear();
+		}
+	}
+
+	Queues bids_;
+	Queues asks_;
+	Queues buyStops_;
+	Queues sellStops_;
+	std::unordered_map<OrderId, Location> where_; // every order in a level or a stop bucket
+	std::optional<Price> lastTradePrice_;
+	std::optional<LadderConfig> ladder_;
+	std::optional<Price> marketCollar_;
+	SelfTradePrevention selfTradePrevention_;
+};
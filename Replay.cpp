@@ -0,0 +1,946 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "Command.h"
+#include "CommandFile.h"
+#include "Journal.h"
+#include "OrderEntry.h"
+#include "OrderEntryReceiver.h"
+#include "OrderFlowGenerator.h"
+#include "Orderbook.h"
+#include "OrderbookConfig.h"
+#include "OrderbookCore.h"
+#include "ReferenceBook.h"
+#include "SnapshotFile.h"
+#include "Trade.h"
+
+// replays recorded order flow through the books and checks them against each other
+// usage:
+//   orderbook_replay record <file> [seed] [commands]   write a command file of mixed flow (OrderFlowGenerator::Mixed)
+//   orderbook_replay run <file> [backend]              stream the file through one backend, or every one by default,
+//                                                      and print its rate and a hash of its results, trades and final book
+//   orderbook_replay fuzz [seed] [rounds] [commands]   differential fuzzing: every round feeds fresh mixed flow to
+//                                                      every core backend and a ReferenceBook of its config, expires
+//                                                      and restarts the books from their journals and snapshots as it
+//                                                      goes, and stops at the first command on which any disagree
+//   orderbook_replay check                             regression scenarios the random flow is unlikely to hit
+//   orderbook_replay send <file> <port> [gap]          the file as order-entry packets (see OrderEntry) to a local port,
+//                                                      gap microseconds apart (20 by default)
+//   orderbook_replay listen <port> <commands>          receive them into an Orderbook (see OrderEntryReceiver) and print
+//                                                      the same hash as run, with the packets lost on the way
+// the hash is the same for every backend and every run of the same file, a backend that prints another one has diverged
+// backends: map, ladder, direct (a small direct order id window, so collisions spill to the hashed index), lazy (lazy
+// cancels, compacted a little after every command), orderbook (the locking wrapper, one ApplyCommands per command)
+namespace
+{
+	constexpr std::uint64_t DefaultSeed = 42;
+	constexpr std::size_t DefaultCommands = 1'000'000;
+	constexpr std::size_t DefaultRounds = 200;
+	constexpr std::size_t DefaultFuzzCommands = 5'000;
+	constexpr std::size_t CompactPerCommand = 4; // tombstones a lazy book releases after each command
+	constexpr std::size_t DirectWindow = 64;
+	constexpr std::size_t ExpireEvery = 100;		 // fuzz commands between two ExpireOrders calls, at Mixed's time of the command
+	constexpr std::size_t CheckpointEvery = 1'000; // fuzz commands between two restarts of every backend from its journal
+	constexpr std::uint64_t DefaultPacketGap = 20; // microseconds
+	constexpr std::chrono::milliseconds ListenStart{60'000}; // for the first packet
+	constexpr std::chrono::milliseconds ListenIdle{2'000};	 // after that, the flow has ended or broken off
+
+	struct Backend
+	{
+		const char *name_;
+		OrderbookConfig config_;
+	};
+	std::vector<Backend> CoreBackends()
+	{
+		// a band around every price Mixed draws, with room for the stops' limits
+		const OrderFlowGenerator prices{0};
+		OrderbookConfig map;
+		OrderbookConfig ladder = map;
+		ladder.ladder_ = LadderConfig{prices.Mid() - prices.Depth(), 1, static_cast<std::size_t>(2 * prices.Depth())};
+		OrderbookConfig direct = ladder;
+		direct.directOrderIdWindow_ = DirectWindow;
+		OrderbookConfig lazy = direct;
+		lazy.lazyCancel_ = true;
+		return {{"map", map}, {"ladder", ladder}, {"direct", direct}, {"lazy", lazy}};
+	}
+	// the same books, and books whose config changes what they do, each checked against a reference of its own config:
+	// a ladder too narrow and too coarse for the band, a market collar, and each self-trade prevention mode
+	std::vector<Backend> FuzzBackends()
+	{
+		std::vector<Backend> backends = CoreBackends();
+		const OrderFlowGenerator prices{0};
+		OrderbookConfig narrow;
+		narrow.ladder_ = LadderConfig{prices.Mid() - 6, 2, 7};
+		OrderbookConfig collar;
+		collar.marketCollar_ = 2;
+		OrderbookConfig newest;
+		newest.selfTradePrevention_ = SelfTradePrevention::CancelNewest;
+		OrderbookConfig oldest = backends[1].config_; // on the ladder, its fill or kill check walks orders rather than the quantities
+		oldest.selfTradePrevention_ = SelfTradePrevention::CancelOldest;
+		OrderbookConfig decrement = backends[3].config_; // lazy cancels, the decrements leave tombstones
+		decrement.selfTradePrevention_ = SelfTradePrevention::DecrementBoth;
+		backends.insert(backends.end(), {{"narrow", narrow}, {"collar", collar}, {"newest", newest}, {"oldest", oldest}, {"decrement", decrement}});
+		return backends;
+	}
+
+	// FNV-1a over the values fed to it, a fingerprint of everything a book did with a stream
+	class Hash
+	{
+	public:
+		void Add(std::uint64_t value)
+		{
+			for (int i = 0; i < 8; ++i)
+			{
+				hash_ = (hash_ ^ ((value >> (8 * i)) & 0xff)) * 0x100000001b3;
+			}
+		}
+		void Add(const Trade &trade)
+		{
+			for (const TradeInfo &info : {trade.GetBidTrade(), trade.GetAskTrade()})
+			{
+				Add(info.orderId_);
+				Add(static_cast<std::uint32_t>(info.price_));
+				Add(info.quantity_);
+			}
+		}
+		std::uint64_t Value() const { return hash_; }
+
+	private:
+		std::uint64_t hash_{0xcbf29ce484222325};
+	};
+
+	// one resting or waiting order as the books are compared on it
+	struct Resting
+	{
+		OrderId orderId_;
+		Side side_;
+		Price price_;
+		Quantity remaining_;
+		bool operator==(const Resting &) const = default;
+	};
+	struct BookState
+	{
+		std::vector<Resting> resting_;
+		std::vector<Resting> stops_;
+		bool operator==(const BookState &) const = default;
+	};
+	BookState StateOf(const OrderbookCore &core)
+	{
+		BookState state;
+		core.ForEachRestingOrder([&](const Order &order)
+								 { state.resting_.push_back(Resting{order.GetOrderID(), order.GetSide(), order.GetPrice(), order.GetRemainingQuantity()}); });
+		core.ForEachStopOrder([&](const Order &order)
+							  { state.stops_.push_back(Resting{order.GetOrderID(), order.GetSide(), order.GetPrice(), order.GetRemainingQuantity()}); });
+		return state;
+	}
+	BookState StateOf(const ReferenceBook &book)
+	{
+		BookState state;
+		book.ForEachRestingOrder([&](OrderId orderId, Side side, Price price, Quantity remaining)
+								 { state.resting_.push_back(Resting{orderId, side, price, remaining}); });
+		book.ForEachStopOrder([&](OrderId orderId, Side side, Price price, Quantity remaining)
+							  { state.stops_.push_back(Resting{orderId, side, price, remaining}); });
+		return state;
+	}
+
+	template <typename Book>
+	void AddBook(Hash &hash, const Book &book) // the final depth and order count
+	{
+		const OrderbookLevelInfos depth = book.GetOrderInfos();
+		for (const LevelInfos *levels : {&depth.GetBids(), &depth.GetAsks()})
+		{
+			hash.Add(levels->size());
+			for (const LevelInfo &level : *levels)
+			{
+				hash.Add(static_cast<std::uint32_t>(level.price_));
+				hash.Add(level.quantity_);
+			}
+		}
+		hash.Add(book.Size());
+	}
+
+	// the commands are decoded up front, the clock only runs around the book
+	// what is hashed is what any book shows: each command's result and fills, then the final depth and order count
+	template <typename Book, typename Apply>
+	void Stream(const char *name, const Commands &commands, const Book &book, Apply &&apply)
+	{
+		Hash hash;
+		Trades trades;
+		trades.reserve(1024);
+		std::size_t fills = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (const Command &command : commands)
+		{
+			hash.Add(apply(command, trades));
+			for (const Trade &trade : trades)
+			{
+				hash.Add(trade);
+			}
+			fills += trades.size();
+			trades.clear();
+		}
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		AddBook(hash, book);
+		std::printf("%-9s %11.0f msgs/s  %zu commands, %zu fills, %zu resting  hash %016" PRIx64 "\n",
+					name, static_cast<double>(commands.size()) / elapsed.count(), commands.size(), fills, book.Size(), hash.Value());
+	}
+
+	int Record(int argc, char **argv)
+	{
+		if (argc < 3)
+		{
+			std::fprintf(stderr, "usage: orderbook_replay record <file> [seed] [commands]\n");
+			return 2;
+		}
+		const std::uint64_t seed = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : DefaultSeed;
+		const std::size_t count = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : DefaultCommands;
+		OrderFlowGenerator generator{seed};
+		CommandFile::Save(generator.Mixed(count), argv[2]);
+		std::printf("%zu commands of seed %llu written to %s\n", count, static_cast<unsigned long long>(seed), argv[2]);
+		return 0;
+	}
+
+	int Run(int argc, char **argv)
+	{
+		if (argc < 3)
+		{
+			std::fprintf(stderr, "usage: orderbook_replay run <file> [map|ladder|direct|lazy|orderbook]\n");
+			return 2;
+		}
+		const Commands commands = CommandFile::Load(argv[2]);
+		const std::string_view only = argc > 3 ? argv[3] : "";
+		bool ran = false;
+		for (const Backend &backend : CoreBackends())
+		{
+			if (!only.empty() && only != backend.name_)
+			{
+				continue;
+			}
+			OrderbookCore core{backend.config_};
+			const bool lazy = backend.config_.lazyCancel_;
+			Stream(backend.name_, commands, core, [&](const Command &command, Trades &trades)
+				   {
+					   const bool applied = core.Apply(command, trades);
+					   if (lazy)
+					   {
+						   core.CompactLevels(CompactPerCommand);
+					   }
+					   return applied; });
+			ran = true;
+		}
+		if (only.empty() || only == "orderbook")
+		{
+			Orderbook orderbook;
+			CommandResults results;
+			Stream("orderbook", commands, orderbook, [&](const Command &command, Trades &trades)
+				   {
+					   results.clear();
+					   orderbook.ApplyCommands(std::span{&command, 1}, results, trades);
+					   return results.front().applied_; });
+			ran = true;
+		}
+		if (!ran)
+		{
+			std::fprintf(stderr, "unknown backend %s\n", argv[3]);
+			return 2;
+		}
+		return 0;
+	}
+
+	// a command file as order-entry packets to a local port, paced so a receiver on the same host keeps up
+	int Send(int argc, char **argv)
+	{
+		if (argc < 4)
+		{
+			std::fprintf(stderr, "usage: orderbook_replay send <file> <port> [microseconds between packets]\n");
+			return 2;
+		}
+		const Commands commands = CommandFile::Load(argv[2]);
+		const auto port = static_cast<std::uint16_t>(std::strtoul(argv[3], nullptr, 10));
+		const std::chrono::microseconds gap{argc > 4 ? std::strtoull(argv[4], nullptr, 10) : DefaultPacketGap};
+		const int socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = htons(port);
+		if (socket < 0 || ::connect(socket, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+		{
+			std::fprintf(stderr, "cannot send to port %u: %s\n", static_cast<unsigned>(port), std::strerror(errno));
+			return 1;
+		}
+		OrderEntry::Writer writer;
+		std::size_t packets = 0;
+		auto flush = [&]
+		{
+			const auto packet = writer.Packet();
+			if (::send(socket, packet.data(), packet.size(), 0) < 0)
+			{
+				std::fprintf(stderr, "send failed: %s\n", std::strerror(errno));
+			}
+			writer.Clear();
+			++packets;
+			std::this_thread::sleep_for(gap);
+		};
+		for (const Command &command : commands)
+		{
+			if (!writer.Append(command))
+			{
+				flush();
+				writer.Append(command);
+			}
+		}
+		if (writer.Count())
+		{
+			flush();
+		}
+		::close(socket);
+		std::printf("%zu commands sent in %zu packets to port %u\n", commands.size(), packets, static_cast<unsigned>(port));
+		return 0;
+	}
+
+	// order-entry packets from a port into an Orderbook, one ApplyPackets per receive, until the expected number of commands
+	// has been applied or the flow stops; the hash is the one run prints for the orderbook backend, when nothing was lost
+	int Listen(int argc, char **argv)
+	{
+		if (argc < 4)
+		{
+			std::fprintf(stderr, "usage: orderbook_replay listen <port> <commands>\n");
+			return 2;
+		}
+		OrderEntryReceiver receiver{static_cast<std::uint16_t>(std::strtoul(argv[2], nullptr, 10))};
+		const std::size_t expected = std::strtoull(argv[3], nullptr, 10);
+		Orderbook orderbook;
+		OrderEntry::Reader reader;
+		CommandResults results;
+		Trades trades;
+		Hash hash;
+		std::size_t applied = 0, fills = 0;
+		std::printf("listening on port %u\n", static_cast<unsigned>(receiver.Port()));
+		std::fflush(stdout);
+		while (applied < expected)
+		{
+			const auto packets = receiver.Receive(applied ? ListenIdle : ListenStart);
+			if (packets.empty())
+			{
+				break;
+			}
+			results.clear();
+			trades.clear();
+			applied += orderbook.ApplyPackets(packets, reader, results, trades);
+			for (const CommandResult &result : results)
+			{
+				hash.Add(result.applied_);
+				for (std::size_t t = result.firstTrade_; t < result.firstTrade_ + result.tradeCount_; ++t)
+				{
+					hash.Add(trades[t]);
+				}
+			}
+			fills += trades.size();
+		}
+		AddBook(hash, orderbook);
+		std::printf("orderbook %zu commands, %zu fills, %zu resting  hash %016" PRIx64 "  (%" PRIu64 " lost, %" PRIu64 " malformed)\n",
+					applied, fills, orderbook.Size(), hash.Value(), reader.Lost(), reader.Malformed());
+		return applied == expected && !reader.Lost() ? 0 : 1;
+	}
+
+	void Describe(const Command &command)
+	{
+		std::fprintf(stderr, "  command: type %d, order type %d, id %" PRIu64 ", side %d, price %d, quantity %u, display %u, stop %d\n",
+					 static_cast<int>(command.type_), static_cast<int>(command.orderType_), command.orderId_, static_cast<int>(command.side_),
+					 command.price_, command.quantity_, command.displayQuantity_, command.stopPrice_);
+	}
+	bool SameTrades(const Trades &left, const Trades &right)
+	{
+		auto same = [](const TradeInfo &a, const TradeInfo &b)
+		{ return a.orderId_ == b.orderId_ && a.price_ == b.price_ && a.quantity_ == b.quantity_; };
+		if (left.size() != right.size())
+		{
+			return false;
+		}
+		for (std::size_t i = 0; i < left.size(); ++i)
+		{
+			if (!same(left[i].GetBidTrade(), right[i].GetBidTrade()) || !same(left[i].GetAskTrade(), right[i].GetAskTrade()))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+	bool SameDepth(const LevelInfos &left, const LevelInfos &right)
+	{
+		return left.size() == right.size() && std::equal(left.begin(), left.end(), right.begin(), [](const LevelInfo &a, const LevelInfo &b)
+														 { return a.price_ == b.price_ && a.quantity_ == b.quantity_; });
+	}
+
+	// one round: every command goes to each backend and to a reference of the backend's config, their answers, fills and
+	// depth must agree after every command, the orders they expire every ExpireEvery commands, and their orders, queue by
+	// queue, their last trade price and next expiry at every checkpoint and at the end
+	// every backend journals, and at each checkpoint it is restarted the way a book is after a crash: the snapshot of the
+	// last checkpoint is loaded (none at the first), the journal replayed from where it left off, and the rebuilt book
+	// must equal the live one before it takes the live one's place; then a snapshot is taken for the next checkpoint
+	struct FuzzBook
+	{
+		Backend backend_;
+		std::string journalPath_;
+		std::string snapshotPath_;
+		std::unique_ptr<Journal> journal_;
+		std::unique_ptr<OrderbookCore> core_;
+		ReferenceBook reference_;
+		bool snapshotted_{false};
+	};
+	const char *Compare(const OrderbookCore &core, const ReferenceBook &reference)
+	{
+		return !(StateOf(core) == StateOf(reference))				 ? "its orders"
+			   : core.LastTradePrice() != reference.LastTradePrice() ? "its last trade price"
+			   : core.NextExpiry() != reference.NextExpiry()		 ? "its next expiry"
+																	 : nullptr;
+	}
+	const char *Restart(FuzzBook &book)
+	{
+		book.journal_->Flush();
+		auto restarted = std::make_unique<OrderbookCore>(book.backend_.config_);
+		const std::uint64_t position = book.snapshotted_ ? SnapshotFile::Load(book.snapshotPath_, *restarted) : 0;
+		Journal::Replay(book.journalPath_, *restarted, position);
+		if (!(StateOf(*restarted) == StateOf(*book.core_)) || restarted->LastTradePrice() != book.core_->LastTradePrice() ||
+			restarted->NextExpiry() != book.core_->NextExpiry())
+		{
+			return "its restart from the snapshot and the journal";
+		}
+		book.core_ = std::move(restarted);
+		SnapshotFile::Save(*book.core_, book.snapshotPath_);
+		book.snapshotted_ = true;
+		return nullptr;
+	}
+	bool FuzzRound(std::uint64_t seed, std::size_t count)
+	{
+		OrderFlowGenerator generator{seed};
+		const Commands commands = generator.Mixed(count);
+		std::vector<FuzzBook> books;
+		for (const Backend &backend : FuzzBackends())
+		{
+			const std::string path = std::string{"orderbook_replay_fuzz_"} + backend.name_;
+			std::remove((path + ".journal").c_str());
+			FuzzBook &book = books.emplace_back(FuzzBook{backend, path + ".journal", path + ".snapshot", nullptr, nullptr, ReferenceBook{backend.config_}});
+			book.journal_ = std::make_unique<Journal>(book.journalPath_);
+			book.backend_.config_.journal_ = book.journal_.get();
+			book.core_ = std::make_unique<OrderbookCore>(book.backend_.config_);
+		}
+		auto fail = [&](const FuzzBook &book, const char *what, std::size_t i)
+		{
+			std::fprintf(stderr, "seed %llu: %s backend differs from the reference in %s at command %zu\n",
+						 static_cast<unsigned long long>(seed), book.backend_.name_, what, i);
+			return false;
+		};
+		bool agreed = true;
+		Trades expected, actual;
+		for (std::size_t i = 0; agreed && i < commands.size(); ++i)
+		{
+			const Command &command = commands[i];
+			for (FuzzBook &book : books)
+			{
+				OrderbookCore &core = *book.core_;
+				expected.clear();
+				actual.clear();
+				const bool applied = book.reference_.Apply(command, expected);
+				const bool coreApplied = core.Apply(command, actual);
+				core.CompactLevels(CompactPerCommand);
+				const OrderbookLevelInfos depth = core.GetOrderInfos();
+				const char *what = coreApplied != applied								   ? "the result"
+								   : !SameTrades(actual, expected)						   ? "the fills"
+								   : !SameDepth(depth.GetBids(), book.reference_.Depth(Side::Buy)) ? "the bids"
+								   : !SameDepth(depth.GetAsks(), book.reference_.Depth(Side::Sell)) ? "the asks"
+								   : core.Size() != book.reference_.Size()				   ? "the order count"
+																						   : nullptr;
+				if (!what && i % ExpireEvery == ExpireEvery - 1)
+				{
+					const ExpiryTime now = OrderFlowGenerator::MixedTime(i);
+					what = core.ExpireOrders(now, std::numeric_limits<std::size_t>::max()) != book.reference_.ExpireOrders(now) ? "the orders it expired" : nullptr;
+				}
+				if (!what && i % CheckpointEvery == CheckpointEvery - 1 && !(what = Compare(core, book.reference_)))
+				{
+					what = Restart(book);
+				}
+				if (what)
+				{
+					agreed = fail(book, what, i);
+					Describe(command);
+					break;
+				}
+			}
+		}
+		for (const FuzzBook &book : books)
+		{
+			if (const char *what = agreed ? Compare(*book.core_, book.reference_) : nullptr)
+			{
+				agreed = fail(book, what, commands.size());
+			}
+		}
+		for (FuzzBook &book : books)
+		{
+			book.core_.reset();
+			book.journal_.reset();
+			std::remove(book.journalPath_.c_str());
+			std::remove(book.snapshotPath_.c_str());
+		}
+		return agreed;
+	}
+
+	// regression scenarios the random flow is unlikely to hit, each on a fresh book
+	// a scenario returns what went wrong, nullptr when the book behaved
+	using Scenario = const char *(*)();
+	const ExpiryTime Later = std::chrono::system_clock::now() + std::chrono::hours(1);
+
+	const char *StopWithExpiry()
+	{
+		for (const OrderType type : {OrderType::Stop, OrderType::StopLimit})
+		{
+			OrderbookCore core{OrderbookConfig{}};
+			Trades trades;
+			core.AddOrder(Order{type, 1, Side::Buy, 110, 10, Later, 0, 105}, trades);
+			if (core.NextExpiry() != Later)
+			{
+				return "an armed stop with an expiry is not in the expiry index";
+			}
+			if (!core.CancelOrder(1) || core.Size() != 0 || core.NextExpiry())
+			{
+				return "cancelling an armed stop with an expiry left it behind";
+			}
+			core.AddOrder(Order{type, 2, Side::Buy, 110, 10, Later, 0, 105}, trades);
+			if (core.ExpireOrders(Later, 16) != 1 || core.Size() != 0 || core.NextExpiry())
+			{
+				return "an armed stop was not expired at its expiry";
+			}
+		}
+		// triggered, a stop limit rests till the expiry it carried
+		OrderbookCore core{OrderbookConfig{}};
+		Trades trades;
+		core.AddOrder(Order{OrderType::StopLimit, 1, Side::Buy, 100, 10, Later, 0, 105}, trades);
+		core.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, 105, 1}, trades);
+		core.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Buy, 105, 1}, trades);
+		if (core.Size() != 1 || core.NextExpiry() != Later || !core.CancelOrder(1) || core.NextExpiry())
+		{
+			return "a triggered stop limit lost the expiry it carried";
+		}
+		return nullptr;
+	}
+
+	Quantity Filled(const Trades &trades)
+	{
+		Quantity filled = 0;
+		for (const Trade &trade : trades)
+		{
+			filled += trade.GetBidTrade().quantity_;
+		}
+		return filled;
+	}
+	// a fill or kill is all or none under every self-trade prevention mode: the owner's own orders do not count towards it
+	const char *FillOrKillWithSelfTradePrevention()
+	{
+		for (std::size_t mode = 0; mode < SelfTradePreventionCount; ++mode)
+		{
+			const auto stp = static_cast<SelfTradePrevention>(mode);
+			for (const bool deeper : {false, true})
+			{
+				OrderbookConfig config;
+				config.selfTradePrevention_ = stp;
+				OrderbookCore core{config};
+				Trades trades;
+				core.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, 100, 5, ExpiryTime::max(), 0, 0, 2}, trades);
+				core.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, 100, 5, ExpiryTime::max(), 0, 0, 1}, trades);
+				if (deeper) // enough behind the owner's own order for a mode that passes over it
+				{
+					core.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Sell, 101, 5, ExpiryTime::max(), 0, 0, 3}, trades);
+				}
+				const bool accepted = core.AddOrder(Order{OrderType::FillOrKill, 4, Side::Buy, 101, 10, ExpiryTime::max(), 0, 0, 1}, trades);
+				// without prevention the owner trades with itself, cancel oldest reaches past its own order when there is more
+				const bool fillable = stp == SelfTradePrevention::None || (stp == SelfTradePrevention::CancelOldest && deeper);
+				if (accepted != fillable || Filled(trades) != (fillable ? 10u : 0u))
+				{
+					return "a fill or kill was filled in part, or refused when it could fill";
+				}
+				if (!fillable && core.Size() != (deeper ? 3u : 2u))
+				{
+					return "a refused fill or kill changed the book";
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	// a collar from a touch at the edge of the price range reaches no further than the edge, and cannot be negative
+	const char *MarketCollarAtTheEdge()
+	{
+		constexpr Price highest = std::numeric_limits<Price>::max(), lowest = std::numeric_limits<Price>::min();
+		OrderbookConfig config;
+		config.marketCollar_ = 10;
+		OrderbookCore core{config};
+		Trades trades;
+		core.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, highest - 5, 5}, trades);
+		core.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, highest, 5}, trades);
+		core.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Buy, lowest + 5, 5}, trades);
+		core.AddOrder(Order{OrderType::GoodTillCancel, 4, Side::Buy, lowest, 5}, trades);
+		core.AddOrder(Order{5, Side::Buy, 20}, trades);
+		core.AddOrder(Order{6, Side::Sell, 20}, trades);
+		if (Filled(trades) != 20 || core.Size() != 0)
+		{
+			return "a market order did not reach the levels within its collar at the edge of the price range";
+		}
+		config.marketCollar_ = -1;
+		try
+		{
+			OrderbookCore negative{config};
+			return "a negative market collar was accepted";
+		}
+		catch (const std::invalid_argument &)
+		{
+		}
+		return nullptr;
+	}
+
+	// a snapshot that is damaged anywhere is refused whole, the book stays empty and can take the good one after
+	const char *CorruptSnapshot()
+	{
+		const std::string path = "orderbook_replay_check.snapshot";
+		{
+			OrderbookCore core{OrderbookConfig{}};
+			Trades trades;
+			core.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Buy, 99, 5}, trades);
+			core.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, 101, 5}, trades);
+			core.AddOrder(Order::Stop(3, Side::Buy, 105, 5), trades);
+			SnapshotFile::Save(core, path);
+		}
+		std::vector<char> good;
+		{
+			std::ifstream in{path, std::ios::binary};
+			good.assign(std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{});
+		}
+		const std::size_t last = sizeof(SnapshotFile::Header) + 2 * sizeof(SnapshotFile::Record);
+		auto write = [&](std::vector<char> bytes)
+		{
+			std::ofstream{path, std::ios::binary | std::ios::trunc}.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+		};
+		std::vector<std::vector<char>> corrupt(4, good);
+		corrupt[0][last + offsetof(SnapshotFile::Record, side_)] = 7;
+		corrupt[1][last + offsetof(SnapshotFile::Record, orderType_)] = static_cast<char>(OrderTypeCount);
+		corrupt[2].resize(good.size() - 3);
+		corrupt[3][offsetof(SnapshotFile::Header, orderCount_) + 7] = 0x40; // a count whose size overflows
+		const char *what = nullptr;
+		OrderbookCore core{OrderbookConfig{}};
+		for (const auto &bytes : corrupt)
+		{
+			write(bytes);
+			try
+			{
+				SnapshotFile::Load(path, core);
+				what = "a corrupt snapshot was loaded";
+			}
+			catch (const std::runtime_error &)
+			{
+			}
+			if (core.Size() != 0)
+			{
+				what = "a corrupt snapshot left part of itself in the book";
+			}
+		}
+		write(good);
+		if (!what && (SnapshotFile::Load(path, core), core.Size() != 3))
+		{
+			what = "the good snapshot did not load after the corrupt ones were refused";
+		}
+		std::remove(path.c_str());
+		return what;
+	}
+
+	// every order's last report is done_, also when what is left of it goes without trading
+	std::vector<ExecutionReport> Reports(OrderbookCore &core)
+	{
+		std::vector<ExecutionReport> reports;
+		for (ExecutionReport report; core.TryPollExecutionReport(report);)
+		{
+			reports.push_back(report);
+		}
+		return reports;
+	}
+	bool Is(const ExecutionReport &report, OrderId orderId, ExecutionReport::Kind kind, Quantity last, Quantity leaves, Quantity cumulative)
+	{
+		return report.orderId_ == orderId && report.kind_ == kind && report.lastQuantity_ == last && report.leavesQuantity_ == leaves &&
+			   report.cumulativeQuantity_ == cumulative && report.done_ == (leaves == 0);
+	}
+	const char *ExecutionReportsOfDroppedQuantity()
+	{
+		using enum ExecutionReport::Kind;
+		OrderbookConfig config;
+		config.executionReportCapacity_ = 64;
+		Trades trades;
+		{
+			OrderbookCore core{config};
+			core.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, 100, 5}, trades);
+			core.AddOrder(Order{OrderType::ImmediateOrCancel, 2, Side::Buy, 100, 8}, trades);
+			const auto reports = Reports(core);
+			if (reports.size() != 3 || !Is(reports[0], 1, Fill, 5, 0, 5) || !Is(reports[1], 2, Fill, 5, 3, 5) || !Is(reports[2], 2, Cancelled, 3, 0, 5))
+			{
+				return "an immediate order's dropped remainder was not reported";
+			}
+		}
+		for (const auto stp : {SelfTradePrevention::CancelNewest, SelfTradePrevention::CancelOldest, SelfTradePrevention::DecrementBoth})
+		{
+			config.selfTradePrevention_ = stp;
+			OrderbookCore core{config};
+			core.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, 100, 3, ExpiryTime::max(), 0, 0, 1}, trades);
+			core.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Buy, 100, 5, ExpiryTime::max(), 0, 0, 1}, trades);
+			const auto reports = Reports(core);
+			const bool reported = stp == SelfTradePrevention::CancelNewest	? reports.size() == 1 && Is(reports[0], 2, Cancelled, 5, 0, 0)
+								  : stp == SelfTradePrevention::CancelOldest ? reports.size() == 1 && Is(reports[0], 1, Cancelled, 3, 0, 0)
+																			 : reports.size() == 2 && Is(reports[0], 1, Cancelled, 3, 0, 0) && Is(reports[1], 2, Cancelled, 3, 2, 0);
+			if (!reported || reports.front().owner_ != 1)
+			{
+				return "what self-trade prevention took was not reported";
+			}
+			if (stp == SelfTradePrevention::DecrementBoth) // what rests counts from what the decrement left
+			{
+				core.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Sell, 100, 2}, trades);
+				const auto fills = Reports(core);
+				if (fills.size() != 2 || !Is(fills[0], 2, Fill, 2, 0, 2))
+				{
+					return "a decremented order that rested reported its fills against its old size";
+				}
+			}
+		}
+		config.selfTradePrevention_ = SelfTradePrevention::None;
+		OrderbookCore core{config};
+		core.AddOrder(Order{OrderType::GoodTillDate, 1, Side::Buy, 100, 5, Later}, trades);
+		core.ExpireOrders(Later, 16);
+		const auto reports = Reports(core);
+		if (reports.size() != 1 || !Is(reports[0], 1, Cancelled, 5, 0, 0))
+		{
+			return "an expiry was not reported";
+		}
+		return nullptr;
+	}
+
+	// a stop released into a book that refuses it (a stop market with nothing to trade against) still ends with a report
+	const char *TriggeredStopRefused()
+	{
+		OrderbookConfig config;
+		config.executionReportCapacity_ = 64;
+		OrderbookCore core{config};
+		Trades trades;
+		core.AddOrder(Order::Stop(1, Side::Sell, 100, 5), trades);
+		core.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Buy, 100, 3}, trades);
+		core.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Sell, 100, 3}, trades); // empties the bids and triggers the stop
+		const auto reports = Reports(core);
+		if (core.Size() != 0 || reports.empty() || !Is(reports.back(), 1, ExecutionReport::Kind::Cancelled, 5, 0, 0))
+		{
+			return "a released stop the book refused left no done report";
+		}
+		return nullptr;
+	}
+
+	// an order's cumulative quantity is what it traded, never what self-trade prevention took, and it never goes back
+	const char *CumulativeQuantityUnderDecrementBoth()
+	{
+		OrderbookConfig config;
+		config.executionReportCapacity_ = 64;
+		config.selfTradePrevention_ = SelfTradePrevention::DecrementBoth;
+		for (const OrderType type : {OrderType::ImmediateOrCancel, OrderType::GoodTillCancel})
+		{
+			OrderbookCore core{config};
+			Trades trades;
+			core.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, 100, 4, ExpiryTime::max(), 0, 0, 1}, trades);
+			core.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, 100, 6, ExpiryTime::max(), 0, 0, 2}, trades);
+			core.AddOrder(Order{type, 3, Side::Buy, 100, 10, ExpiryTime::max(), 0, 0, 1}, trades);
+			std::unordered_map<OrderId, Quantity> traded;
+			std::unordered_map<OrderId, std::size_t> done;
+			for (const ExecutionReport &report : Reports(core))
+			{
+				if (report.kind_ == ExecutionReport::Kind::Fill)
+				{
+					traded[report.orderId_] += report.lastQuantity_;
+				}
+				if (report.cumulativeQuantity_ != traded[report.orderId_])
+				{
+					return "a cumulative quantity was not what the order had traded";
+				}
+				done[report.orderId_] += report.done_;
+			}
+			if (traded[3] != 6 || done[1] != 1 || done[2] != 1 || done[3] != 1)
+			{
+				return "an order was not done exactly once";
+			}
+		}
+		return nullptr;
+	}
+
+	// packets go into the book the way the same commands do, and what the book must never see is dropped at the reader
+	const char *OrderEntryPackets()
+	{
+		const Commands commands{
+			Command::Add(Order{OrderType::GoodTillCancel, 1, Side::Sell, 101, 10, ExpiryTime::max(), 0, 0, 2}),
+			Command::Add(Order{OrderType::Iceberg, 2, Side::Sell, 102, 20, ExpiryTime::max(), 5}),
+			Command::Add(Order{OrderType::GoodTillDate, 3, Side::Buy, 99, 10, Later}),
+			Command::Add(Order::Stop(4, Side::Buy, 102, 5)),
+			Command::Add(Order{OrderType::FillOrKill, 5, Side::Buy, 101, 10, ExpiryTime::max(), 0, 0, 2}),
+			Command::Modify(OrderModify{3, Side::Buy, 101, 4}),
+			Command::Add(Order{OrderType::ImmediateOrCancel, 6, Side::Buy, 102, 12}),
+			Command::Cancel(2),
+		};
+		OrderEntry::Writer writer;
+		for (const Command &command : commands)
+		{
+			writer.Append(command);
+		}
+		OrderbookConfig config;
+		config.selfTradePrevention_ = SelfTradePrevention::CancelNewest;
+		OrderbookCore fromCommands{config}, fromPacket{config};
+		CommandResults expected, results;
+		Trades expectedTrades, trades;
+		fromCommands.Apply(commands, expected, expectedTrades);
+		OrderEntry::Reader reader;
+		if (fromPacket.Apply(writer.Packet(), reader, results, trades) != commands.size() || reader.Malformed() || reader.Lost())
+		{
+			return "a well formed packet was not read whole";
+		}
+		bool same = results.size() == expected.size() && SameTrades(trades, expectedTrades) && fromPacket.Size() == fromCommands.Size() &&
+					fromPacket.NextExpiry() == fromCommands.NextExpiry();
+		for (std::size_t i = 0; same && i < results.size(); ++i)
+		{
+			same = results[i].applied_ == expected[i].applied_;
+		}
+		if (!same)
+		{
+			return "a packet did not do to the book what its commands do";
+		}
+		// an order type and a side that do not exist are counted and go no further, the stop with an expiry beside them
+		// is an order like any other and arms with its expiry
+		writer.Clear();
+		writer.Append(Command::Add(Order{OrderType::StopLimit, 7, Side::Buy, 110, 5, Later, 0, 105}));
+		writer.Append(Command::Add(Order{OrderType::GoodTillCancel, 8, Side::Buy, 100, 5}));
+		writer.Append(Command::Add(Order{OrderType::GoodTillCancel, 9, Side::Buy, 100, 5}));
+		writer.Append(Command::Add(Order{OrderType::GoodTillCancel, 10, Side::Buy, 100, 5}));
+		std::vector<std::byte> packet{writer.Packet().begin(), writer.Packet().end()};
+		const std::size_t add = OrderEntry::LengthSize + OrderEntry::AddSize;
+		packet[OrderEntry::HeaderSize + add + OrderEntry::LengthSize + 1] = static_cast<std::byte>(OrderTypeCount);
+		packet[OrderEntry::HeaderSize + 2 * add + OrderEntry::LengthSize + 2] = std::byte{7};
+		results.clear();
+		const std::size_t size = fromPacket.Size();
+		if (fromPacket.Apply(packet, reader, results, trades) != 2 || reader.Malformed() != 2 || fromPacket.Size() != size + 2 ||
+			!results.front().applied_ || !results.back().applied_)
+		{
+			return "a malformed message reached the book, or took the valid ones beside it down";
+		}
+		bool armed = false;
+		fromPacket.ForEachStopOrder([&](const Order &stop)
+									{ armed |= stop.GetOrderID() == 7 && stop.GetExpiry() == Later; });
+		if (!armed)
+		{
+			return "a stop with an expiry from the wire did not arm with its expiry";
+		}
+		return nullptr;
+	}
+
+	int Check()
+	{
+		static constexpr std::pair<const char *, Scenario> scenarios[] = {
+			{"stop with expiry", StopWithExpiry},
+			{"fill or kill with self-trade prevention", FillOrKillWithSelfTradePrevention},
+			{"market collar at the edge of the price range", MarketCollarAtTheEdge},
+			{"corrupt snapshot", CorruptSnapshot},
+			{"execution reports of dropped quantity", ExecutionReportsOfDroppedQuantity},
+			{"triggered stop refused", TriggeredStopRefused},
+			{"cumulative quantity under decrement both", CumulativeQuantityUnderDecrementBoth},
+			{"order-entry packets", OrderEntryPackets},
+		};
+		int failed = 0;
+		for (const auto &[name, scenario] : scenarios)
+		{
+			if (const char *what = scenario())
+			{
+				std::fprintf(stderr, "%s: %s\n", name, what);
+				++failed;
+			}
+		}
+		std::printf("%zu scenarios, %d failed\n", std::size(scenarios), failed);
+		return failed ? 1 : 0;
+	}
+
+	int Fuzz(int argc, char **argv)
+	{
+		const std::uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : DefaultSeed;
+		const std::size_t rounds = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : DefaultRounds;
+		const std::size_t count = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : DefaultFuzzCommands;
+		for (std::size_t round = 0; round < rounds; ++round)
+		{
+			if (!FuzzRound(seed + round, count)) // rerun the seed it prints with one round to reproduce
+			{
+				return 1;
+			}
+		}
+		std::printf("%zu rounds of %zu commands from seed %llu, every backend agrees with the reference\n",
+					rounds, count, static_cast<unsigned long long>(seed));
+		return 0;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const std::string_view mode = argc > 1 ? argv[1] : "";
+	try
+	{
+		if (mode == "record")
+		{
+			return Record(argc, argv);
+		}
+		if (mode == "run")
+		{
+			return Run(argc, argv);
+		}
+		if (mode == "fuzz")
+		{
+			return Fuzz(argc, argv);
+		}
+		if (mode == "check")
+		{
+			return Check();
+		}
+		if (mode == "send")
+		{
+			return Send(argc, argv);
+		}
+		if (mode == "listen")
+		{
+			return Listen(argc, argv);
+		}
+	}
+	catch (const std::exception &error)
+	{
+		std::fprintf(stderr, "%s\n", error.what());
+		return 1;
+	}
+	std::fprintf(stderr, "usage: orderbook_replay record|run|fuzz|check|send|listen ..., see Replay.cpp\n");
+	return 2;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <format>
+#include <stdexcept>
+
+#include "Usings.h"
+
+// the part of a resting order that matching reads and writes, 32 bytes so two share a cache line
+// a level's FIFO is threaded through these alone, so walking a level and filling its orders streams through
+// them without touching the rest of the order (its OrderDetails, kept by the pool in a parallel array at slot_)
+class alignas(32) RestingOrder
+{
+	friend class OrderList; // the intrusive links are owned by the price level the order rests in
+	friend class OrderPool; // and the slot by the pool that holds the order
+
+public:
+	OrderId GetOrderID() const { return orderId_; }
+	Quantity GetRemainingQuantity() const { return remainingQuantity_; }
+	bool IsFilled() const { return remainingQuantity_ == 0; }
+	void Fill(Quantity quantity)
+	{
+		if (quantity > remainingQuantity_)
+		{
+			throw std::logic_error(std::format(
+				"Order {} cannot fill for more than the remaining quantity",
+				orderId_));
+		}
+		remainingQuantity_ -= quantity;
+	}
+	// a lazy cancel: the order stays linked in its level with nothing left (a tombstone) until it is reclaimed
+	// a resting order that is filled leaves its level at once, so a linked order with no quantity is always a tombstone
+	void Kill() { remainingQuantity_ = 0; }
+	void Refill(Quantity slice) { remainingQuantity_ = slice; } // an iceberg's next slice, once the last one is filled
+	void Amend(Quantity remainingQuantity) // reduce-only, the book lowers OrderDetails::initialQuantity_ in step
+	{
+		if (remainingQuantity > remainingQuantity_)
+		{
+			throw std::logic_error(std::format(
+				"Order {} can only be amended down in place",
+				orderId_));
+		}
+		remainingQuantity_ = remainingQuantity;
+	}
+
+private:
+	RestingOrder *prev_{nullptr};
+	RestingOrder *next_{nullptr}; // also the free list link while the slot is unused
+	OrderId orderId_{};
+	Quantity remainingQuantity_{};
+	std::uint32_t slot_{}; // where the pool keeps this order's details
+};
+
+static_assert(sizeof(RestingOrder) == 32, "two resting orders to a cache line");
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+
+// what a book does when an aggressor meets a resting order of its own owner (Order::GetOwner), no trade prints either way
+// orders without an owner (0) never self-trade, and a book without prevention matches them like any other orders
+enum class SelfTradePrevention
+{
+    None,
+    CancelNewest,  // the aggressor is cancelled with what it has left, its fills so far stand
+    CancelOldest,  // the resting order is cancelled and the aggressor goes on to the next one
+    DecrementBoth, // both give up the smaller of their quantities, whichever is left with none is cancelled
+};
+
+inline constexpr std::size_t SelfTradePreventionCount = static_cast<std::size_t>(SelfTradePrevention::DecrementBoth) + 1; // DecrementBoth stays the last mode
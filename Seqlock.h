@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// single writer, many readers: the writer never waits, a reader retries while a write is in flight
+// the sequence is odd during a write; a reader copies the value and keeps it only if the sequence was
+// even and unchanged around the copy
+// the value is held as relaxed atomic words rather than raw bytes, so a torn read is retried, never a data race
+template <typename T>
+class Seqlock
+{
+	static_assert(std::is_trivially_copyable_v<T>, "the value is copied word by word");
+
+public:
+	Seqlock() { Store(T{}); }
+	Seqlock(const Seqlock &) = delete;
+	void operator=(const Seqlock &) = delete;
+
+	void Store(const T &value) // only ever called by the one writer thread
+	{
+		std::array<std::uint64_t, WordCount> words{};
+		std::memcpy(words.data(), &value, sizeof(T));
+		const std::uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+		sequence_.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release); // the odd sequence is visible before any word changes
+		for (std::size_t i = 0; i < WordCount; ++i)
+		{
+			words_[i].store(words[i], std::memory_order_relaxed);
+		}
+		sequence_.store(sequence + 2, std::memory_order_release);
+	}
+
+	T Load() const
+	{
+		std::array<std::uint64_t, WordCount> words{};
+		std::uint64_t before, after;
+		do
+		{
+			before = sequence_.load(std::memory_order_acquire);
+			for (std::size_t i = 0; i < WordCount; ++i)
+			{
+				words[i] = words_[i].load(std::memory_order_relaxed);
+			}
+			std::atomic_thread_fence(std::memory_order_acquire); // the words are read before the sequence is re-checked
+			after = sequence_.load(std::memory_order_relaxed);
+		} while (before != after || (before & 1));
+		T value;
+		std::memcpy(static_cast<void *>(&value), words.data(), sizeof(T)); // trivially copyable, the static_assert above
+		return value;
+	}
+
+private:
+	static constexpr std::size_t WordCount = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+	alignas(64) std::atomic<std::uint64_t> sequence_{0}; // the sequence and the words start a cache line of their own
+	std::array<std::atomic<std::uint64_t>, WordCount> words_{};
+};
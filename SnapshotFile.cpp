@@ -0,0 +1,177 @@
+#include "SnapshotFile.h"
+
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "JournalRecord.h"
+#include "OrderbookCore.h"
+
+static_assert(std::endian::native == std::endian::little, "the snapshot is mapped in place, its records are little-endian");
+
+namespace
+{
+	void WriteAll(int fd, const void *data, std::size_t size, const std::string &path)
+	{
+		auto *bytes = static_cast<const std::byte *>(data);
+		while (size)
+		{
+			const ssize_t written = ::write(fd, bytes, size);
+			if (written < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				const int error = errno;
+				::close(fd);
+				throw std::runtime_error(std::format("Snapshot {} cannot be written: {}", path, std::strerror(error)));
+			}
+			bytes += written;
+			size -= static_cast<std::size_t>(written);
+		}
+	}
+}
+
+void SnapshotFile::Save(const OrderbookCore &core, const std::string &path)
+{
+	const std::string temporary = path + ".tmp";
+	const int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+	{
+		throw std::runtime_error(std::format("Snapshot {} cannot be opened: {}", temporary, std::strerror(errno)));
+	}
+	Header header{};
+	std::memcpy(header.magic_, Magic, sizeof(Magic));
+	header.orderCount_ = core.Size();
+	header.journalPosition_ = core.JournalPosition();
+	const auto lastTradePrice = core.LastTradePrice();
+	header.lastTradePrice_ = lastTradePrice ? *lastTradePrice : std::numeric_limits<std::int64_t>::min();
+	WriteAll(fd, &header, sizeof(header), temporary);
+
+	// the orders go out in batches, one write per batch rather than per order
+	std::vector<Record> batch;
+	batch.reserve(1 << 15);
+	auto flush = [&]
+	{
+		WriteAll(fd, batch.data(), batch.size() * sizeof(Record), temporary);
+		batch.clear();
+	};
+	auto save = [&](const ::Order &order)
+	{
+		batch.push_back(Record{order.GetOrderID(), JournalRecord::EncodeExpiry(order.GetExpiry()), order.GetPrice(),
+							   order.GetInitialQuantity(), order.GetRemainingQuantity(),
+							   static_cast<std::uint8_t>(order.GetSide()), static_cast<std::uint8_t>(order.GetOrderType()), {},
+							   order.GetDisplayQuantity(), order.GetStopPrice(), order.GetOwner(), {}});
+		if (batch.size() == batch.capacity())
+		{
+			flush();
+		}
+	};
+	core.ForEachRestingOrder(save);
+	core.ForEachStopOrder(save);
+	flush();
+	if (::fsync(fd) != 0)
+	{
+		const int error = errno;
+		::close(fd);
+		throw std::runtime_error(std::format("Snapshot {} cannot be synced: {}", temporary, std::strerror(error)));
+	}
+	::close(fd);
+	if (::rename(temporary.c_str(), path.c_str()) != 0)
+	{
+		throw std::runtime_error(std::format("Snapshot {} cannot be renamed to {}: {}", temporary, path, std::strerror(errno)));
+	}
+}
+
+std::uint64_t SnapshotFile::Load(const std::string &path, OrderbookCore &core)
+{
+	if (core.Size())
+	{
+		throw std::logic_error(std::format("Snapshot {} can only be loaded into an empty book", path));
+	}
+	const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		throw std::runtime_error(std::format("Snapshot {} cannot be opened: {}", path, std::strerror(errno)));
+	}
+	struct stat status;
+	if (::fstat(fd, &status) != 0)
+	{
+		const int error = errno;
+		::close(fd);
+		throw std::runtime_error(std::format("Snapshot {} cannot be read: {}", path, std::strerror(error)));
+	}
+	const auto size = static_cast<std::size_t>(status.st_size);
+	if (size < sizeof(Header))
+	{
+		::close(fd);
+		throw std::runtime_error(std::format("{} is not a snapshot", path));
+	}
+	void *mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // the mapping keeps the file alive
+	if (mapped == MAP_FAILED)
+	{
+		throw std::runtime_error(std::format("Snapshot {} cannot be mapped: {}", path, std::strerror(errno)));
+	}
+	::madvise(mapped, size, MADV_SEQUENTIAL); // one front to back pass, let the kernel read ahead
+
+	// the header and the records are read in place, straight out of the page cache
+	// the whole file is checked before the first order goes in, a bad one leaves the book as empty as it was
+	const auto *header = static_cast<const Header *>(mapped);
+	const auto *records = reinterpret_cast<const Record *>(header + 1);
+	auto toOrder = [](const Record &record)
+	{
+		return ::Order{static_cast<OrderType>(record.orderType_), record.orderId_, static_cast<Side>(record.side_), record.price_,
+					   record.initialQuantity_, JournalRecord::DecodeExpiry(record.expiry_), record.displayQuantity_, record.stopPrice_, record.owner_};
+	};
+	std::string error;
+	const std::size_t recordBytes = size - sizeof(Header);
+	if (std::memcmp(header->magic_, Magic, sizeof(Magic)) != 0 || recordBytes % sizeof(Record) != 0 || header->orderCount_ != recordBytes / sizeof(Record))
+	{
+		error = std::format("{} is not a snapshot", path);
+	}
+	std::unordered_set<OrderId> orderIds;
+	if (error.empty())
+	{
+		orderIds.reserve(header->orderCount_);
+	}
+	for (std::uint64_t i = 0; error.empty() && i < header->orderCount_; ++i)
+	{
+		const Record &record = records[i];
+		// the enum bytes first, an Order must never hold a side or a type that does not exist
+		if (record.side_ > static_cast<std::uint8_t>(Side::Sell) || record.orderType_ >= OrderTypeCount ||
+			!core.CanLoadOrder(toOrder(record), record.remainingQuantity_) || !orderIds.insert(record.orderId_).second)
+		{
+			error = std::format("Snapshot {} does not fit the book, order {} cannot be loaded", path, record.orderId_);
+		}
+	}
+	for (std::uint64_t i = 0; error.empty() && i < header->orderCount_; ++i)
+	{
+		const Record &record = records[i];
+		if (!core.LoadOrder(toOrder(record), record.remainingQuantity_)) // checked above, cannot fail
+		{
+			error = std::format("Snapshot {} does not fit the book, order {} cannot be loaded", path, record.orderId_);
+		}
+	}
+	const std::uint64_t journalPosition = header->journalPosition_;
+	if (error.empty() && header->lastTradePrice_ != std::numeric_limits<std::int64_t>::min())
+	{
+		core.LoadLastTradePrice(static_cast<Price>(header->lastTradePrice_));
+	}
+	::munmap(mapped, size);
+	if (!error.empty())
+	{
+		throw std::runtime_error(error);
+	}
+	return journalPosition;
+}
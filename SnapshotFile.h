@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class OrderbookCore;
+
+// a whole book in one flat file, for a warm start without replaying its history
+// layout (native little-endian, the file is mapped and read in place):
+//   Header, then Header::orderCount_ Record entries: the bids level by level from best to worst, each level
+//   in queue order, then the asks the same way, then the waiting stop orders (OrderbookCore::ForEachStopOrder)
+// loading maps the file and appends every record behind the worst level of its side in one pass (OrderbookCore::LoadOrder),
+// so time priority survives and there is no matching, no level search and no allocation beyond the book's own
+// the header remembers the book's journal position, replay the journal from there for the changes since the save
+class SnapshotFile
+{
+public:
+	// written to path.tmp, synced and renamed over path, so a crash mid-save leaves the previous snapshot in place
+	static void Save(const OrderbookCore &core, const std::string &path);
+	// an empty book only, returns the journal position the snapshot covers (Journal::Replay's fromRecord)
+	// throws when the file is not a snapshot or its orders do not fit the book (a duplicate, a price outside the ladder,
+	// a side or order type that does not exist), in which case nothing is loaded
+	static std::uint64_t Load(const std::string &path, OrderbookCore &core);
+
+	struct Header
+	{
+		char magic_[8];
+		std::uint64_t orderCount_;
+		std::uint64_t journalPosition_;
+		std::int64_t lastTradePrice_; // what stops are triggered by, INT64_MIN before the book's first trade
+	};
+	struct Record
+	{
+		std::uint64_t orderId_;
+		std::int64_t expiry_; // nanoseconds since the epoch, INT64_MAX for none
+		std::int32_t price_;
+		std::uint32_t initialQuantity_;
+		std::uint32_t remainingQuantity_;
+		std::uint8_t side_;
+		std::uint8_t orderType_;
+		std::uint8_t reserved_[2];
+		std::uint32_t displayQuantity_; // an iceberg's peak, 0 for other types
+		std::int32_t stopPrice_;		// a stop order's, it is loaded back into the stop index
+		std::uint32_t owner_;			// 0 for none
+		std::uint8_t unused_[4];
+	};
+	static_assert(sizeof(Header) == 32 && sizeof(Record) == 48, "the records are the file format");
+
+private:
+	static constexpr char Magic[8] = {'O', 'B', 'S', 'N', 'A', 'P', '0', '3'}; // 03: records carry the owner
+};
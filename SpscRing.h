@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <vector>
+
+// bounded lock-free ring for exactly one producer thread and one consumer thread
+// each side owns one index and only reads the other's, keeping a cached copy so that the shared
+// cache line is touched only when the ring looks full (producer) or empty (consumer)
+template <typename T>
+class SpscRing
+{
+public:
+	explicit SpscRing(std::size_t capacity) // rounded up to a power of two
+		: slots_(std::bit_ceil(capacity < 2 ? std::size_t{2} : capacity)), mask_{slots_.size() - 1} {}
+	SpscRing(const SpscRing &) = delete;
+	SpscRing &operator=(const SpscRing &) = delete;
+
+	bool TryPush(const T &value) // producer only, false while the ring is full
+	{
+		const std::size_t tail = tail_.load(std::memory_order_relaxed);
+		if (tail - cachedHead_ == slots_.size())
+		{
+			cachedHead_ = head_.load(std::memory_order_acquire);
+			if (tail - cachedHead_ == slots_.size())
+			{
+				return false;
+			}
+		}
+		slots_[tail & mask_] = value;
+		tail_.store(tail + 1, std::memory_order_release); // publishes the slot to the consumer
+		return true;
+	}
+	bool TryPop(T &value) // consumer only, false while the ring is empty
+	{
+		const std::size_t head = head_.load(std::memory_order_relaxed);
+		if (head == cachedTail_)
+		{
+			cachedTail_ = tail_.load(std::memory_order_acquire);
+			if (head == cachedTail_)
+			{
+				return false;
+			}
+		}
+		value = slots_[head & mask_];
+		head_.store(head + 1, std::memory_order_release); // hands the slot back to the producer
+		return true;
+	}
+
+	std::size_t Capacity() const { return slots_.size(); }
+
+private:
+	static constexpr std::size_t CacheLine = 64;
+
+	std::vector<T> slots_;
+	std::size_t mask_;
+	alignas(CacheLine) std::atomic<std::size_t> head_{0}; // next slot to read, written by the consumer
+	std::size_t cachedTail_{0};							   // consumer's last view of tail_
+	alignas(CacheLine) std::atomic<std::size_t> tail_{0}; // next slot to write, written by the producer
+	std::size_t cachedHead_{0};							   // producer's last view of head_
+};
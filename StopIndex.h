@@ -0,0 +1,70 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory_resource>
+
+#include "OrderList.h"
+#include "RestingOrder.h"
+#include "Usings.h"
+
+// the stop orders of one side waiting for the last trade price to reach them, bucketed by stop price
+// a waiting stop is in no price level, so its bucket is an OrderList threaded through its own level links and
+// indexing it never allocates once the bucket exists
+// Compare orders the buckets in trigger order: std::less<Price> for buy stops (released as the price rises, the lowest
+// stop first), std::greater<Price> for sell stops (released as it falls, the highest first)
+template <typename Compare>
+class StopIndex
+{
+public:
+	explicit StopIndex(std::pmr::memory_resource *resource) : buckets_{resource} {}
+
+	bool empty() const { return buckets_.empty(); }
+	// a stop at stopPrice is released by a trade at price: buy stops at or below it, sell stops at or above it
+	static bool IsTriggered(Price stopPrice, Price price) { return !Compare{}(price, stopPrice); }
+	bool AnyTriggered(Price price) const { return !buckets_.empty() && IsTriggered(buckets_.begin()->first, price); }
+
+	void Insert(RestingOrder *order, Price stopPrice) { buckets_[stopPrice].push_back(order); }
+	void Remove(RestingOrder *order, Price stopPrice) // the order must be indexed, its bucket goes away with its last order
+	{
+		auto bucket = buckets_.find(stopPrice);
+		bucket->second.erase(order);
+		if (bucket->second.empty())
+		{
+			buckets_.erase(bucket);
+		}
+	}
+	// unlink every stop a trade at price releases, in trigger order and each bucket in arrival order, handing each
+	// to release once it is unlinked (release may reuse its links)
+	template <typename Fn>
+	void Trigger(Price price, Fn &&release)
+	{
+		while (AnyTriggered(price))
+		{
+			auto bucket = buckets_.begin();
+			while (!bucket->second.empty())
+			{
+				RestingOrder *order = bucket->second.front();
+				bucket->second.pop_front();
+				release(order);
+			}
+			buckets_.erase(bucket);
+		}
+	}
+
+	// visit the waiting stops in trigger order, fn(order)
+	template <typename Fn>
+	void ForEach(Fn &&fn) const
+	{
+		for (const auto &[_, bucket] : buckets_)
+		{
+			for (const RestingOrder &order : bucket)
+			{
+				fn(order);
+			}
+		}
+	}
+
+private:
+	std::pmr::map<Price, OrderList, Compare> buckets_;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <optional>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+
+// pin a thread to one cpu, false when the cpu does not exist or the call is not permitted
+inline bool PinThread(std::thread &thread, unsigned cpu)
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus) == 0;
+}
+inline bool PinCurrentThread(unsigned cpu) // the same for the calling thread, which moves there before it returns
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+}
+
+// keeps the calling thread on one cpu while it lives and gives the thread its previous cpus back after,
+// for building a book on the core it will match on (ThreadPlacement::localMemory_); no cpu, or a pin that fails, changes nothing
+class ScopedPin
+{
+public:
+    explicit ScopedPin(std::optional<unsigned> cpu)
+    {
+        pinned_ = cpu && pthread_getaffinity_np(pthread_self(), sizeof(previous_), &previous_) == 0 && PinCurrentThread(*cpu);
+    }
+    ~ScopedPin()
+    {
+        if (pinned_)
+        {
+            pthread_setaffinity_np(pthread_self(), sizeof(previous_), &previous_);
+        }
+    }
+    ScopedPin(const ScopedPin &) = delete;
+    void operator=(const ScopedPin &) = delete;
+
+private:
+    cpu_set_t previous_;
+    bool pinned_{false};
+};
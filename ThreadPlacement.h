@@ -0,0 +1,15 @@
+#pragma once
+
+#include <optional>
+
+// where a front end runs its threads and builds its book, cpus numbered as sched_setaffinity numbers them
+// left empty, the threads run wherever the scheduler puts them and the book's memory lands wherever it was built
+struct ThreadPlacement
+{
+    std::optional<unsigned> matchingCore_;     // the thread that applies the commands is pinned here
+    std::optional<unsigned> housekeepingCore_; // the thread that expires orders and reclaims tombstones is pinned here
+    // build the book on matchingCore_: a book touches all of its preallocated memory as it is built, and Linux
+    // puts a page on the NUMA node of the cpu that first touches it, so the book ends up local to its matching thread
+    bool localMemory_{false};
+    bool inlineHousekeeping_{false}; // no housekeeping thread, the matching thread's owner runs it in its idle moments
+};
@@ -0,0 +1,54 @@
+#include "TimerService.h"
+
+#include "ThreadAffinity.h"
+
+TimerService::TimerService(std::optional<unsigned> core) : thread_{[this]
+																	{ Run(); }}
+{
+	if (core)
+	{
+		PinThread(thread_, *core);
+	}
+}
+TimerService::~TimerService()
+{
+	{
+		std::scoped_lock lock{mutex_};
+		shutdown_ = true;
+	}
+	wakeUp_.notify_one();
+	thread_.join();
+}
+
+void TimerService::Schedule(Clock::time_point when, Callback callback)
+{
+	{
+		std::scoped_lock lock{mutex_};
+		timers_.emplace(when, std::move(callback));
+	}
+	wakeUp_.notify_one(); // the new deadline may be earlier than the one being waited for
+}
+
+void TimerService::Run()
+{
+	std::unique_lock<std::mutex> lock{mutex_};
+	while (!shutdown_)
+	{
+		if (timers_.empty())
+		{
+			wakeUp_.wait(lock);
+			continue;
+		}
+		const auto next = timers_.begin()->first;
+		if (Clock::now() < next)
+		{
+			wakeUp_.wait_until(lock, next); // woken early by Schedule or shutdown, the loop re-checks
+			continue;
+		}
+		auto callback = std::move(timers_.begin()->second);
+		timers_.erase(timers_.begin());
+		lock.unlock(); // the callback may schedule again
+		callback();
+		lock.lock();
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+// one thread that runs callbacks at wall-clock deadlines, shared by everything that needs a timer
+// so a host with thousands of books keeps one sleeping thread instead of one per book
+class TimerService
+{
+public:
+	using Clock = std::chrono::system_clock;
+	using Callback = std::function<void()>;
+
+	explicit TimerService(std::optional<unsigned> core = std::nullopt); // the timer thread is pinned to core when given
+	TimerService(const TimerService &) = delete;
+	void operator=(const TimerService &) = delete;
+	TimerService(TimerService &&) = delete;
+	void operator=(TimerService &&) = delete;
+	~TimerService(); // pending callbacks are dropped
+
+	// callbacks run on the timer thread, they must be short and must not block on a book
+	// a callback may schedule the next occurrence of itself
+	void Schedule(Clock::time_point when, Callback callback);
+
+private:
+	void Run();
+
+	std::mutex mutex_;
+	std::condition_variable wakeUp_;
+	std::multimap<Clock::time_point, Callback> timers_; // earliest deadline first
+	bool shutdown_{false};
+	std::thread thread_;
+};
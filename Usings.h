@@ -1,9 +1,14 @@
 #pragma once
+#include <chrono>
+#include <cstdint>
 #include <vector>
 
 using Price = std::int32_t;
 using Quantity = std::uint32_t;
 using OrderId = std::uint64_t;
 using OrderIds = std::vector<OrderId>;
+using SymbolId = std::uint32_t;
+using OwnerId = std::uint32_t; // the account or participant an order belongs to, 0 for none
+using ExpiryTime = std::chrono::system_clock::time_point;
 
 